@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RequiredProgramMainCPPInclude.h"
+#include "ClothSolver.h"
+#include "ClothSelfCollision.h"
+#include "ClothArena.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogClothBenchmark, Log, All);
+
+IMPLEMENT_APPLICATION(ClothBenchmark, "ClothBenchmark");
+
+/**
+ * Headless sweep of the cloth solver over grid sizes, substep counts and
+ * feature toggles. Prints one JSON document with ns per particle per step
+ * for every combination, and writes it to -Output= if given.
+ *
+ *   ClothBenchmark -Sizes=30,64,128,256,512 -Substeps=1,5,10 -Steps=60 -Warmup=10 -Features=Baseline,XPBD -Output=bench.json
+ *
+ * The SelfCollisionKernel feature times the self collision hash build and
+ * resolve alone on a crumpled grid of -SelfCollisionParticles= (100000).
+ */
+namespace ClothBenchmark
+{
+    struct FFeature
+    {
+        const TCHAR* Name;
+        // Flip the feature on top of the default settings
+        TFunction<void(ClothSolverSettings&)> Configure;
+        // Anything the feature needs in the built cloth or its inputs
+        TFunction<void(ClothSolver&)> Prepare;
+    };
+
+    TArray<FFeature> MakeFeatures()
+    {
+        TArray<FFeature> Features;
+        Features.Add({ TEXT("Baseline"), [](ClothSolverSettings&) {}, [](ClothSolver&) {} });
+        Features.Add({ TEXT("NoInterwoven"), [](ClothSolverSettings& _settings) { _settings.SimulateInterwovenConstraints = false; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("NoTethers"), [](ClothSolverSettings& _settings) { _settings.UseTethers = false; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("ParallelBatches"), [](ClothSolverSettings& _settings) { _settings.SolverType = EClothSolverType::ParallelBatches; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("XPBD"), [](ClothSolverSettings& _settings) { _settings.SolverType = EClothSolverType::XPBD; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("Hierarchy"), [](ClothSolverSettings& _settings) { _settings.HierarchicalSolve = true; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("SelfCollision"), [](ClothSolverSettings& _settings) { _settings.SelfCollision = true; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("Sleeping"), [](ClothSolverSettings& _settings) { _settings.AllowSleeping = true; }, [](ClothSolver&) {} });
+        Features.Add({ TEXT("Aerodynamics"), [](ClothSolverSettings& _settings) { _settings.AerodynamicWind = true; }, [](ClothSolver& _solver)
+        {
+            // A turbulent field over the whole cloth
+            TSharedPtr<ClothWindField, ESPMode::ThreadSafe> Field = MakeShared<ClothWindField, ESPMode::ThreadSafe>();
+            Field->Initialise(FBox3f(FVector3f(-500.0f), FVector3f(500.0f)), FIntVector(16));
+            for (int32 i = 0; i < Field->Velocities.Num(); i++)
+            {
+                Field->Velocities[i] = FVector3f(0.0f, 300.0f, 0.0f) + FVector3f(FMath::Sin(i * 0.37f), FMath::Cos(i * 0.21f), FMath::Sin(i * 0.11f)) * 100.0f;
+            }
+            _solver.Inputs.WindField = Field;
+        } });
+        Features.Add({ TEXT("Colliders"), [](ClothSolverSettings&) {}, [](ClothSolver& _solver)
+        {
+            ClothCollider Sphere;
+            Sphere.Type = EClothColliderType::Sphere;
+            Sphere.Center = FVector3f(0.0f, 60.0f, 0.0f);
+            Sphere.Radius = 50.0f;
+            Sphere.UpdateBounds();
+            _solver.Inputs.Colliders.Add(Sphere);
+
+            ClothCollider Box;
+            Box.Type = EClothColliderType::Box;
+            Box.Center = FVector3f(60.0f, 40.0f, -60.0f);
+            Box.HalfExtents = FVector3f(30.0f);
+            Box.UpdateBounds();
+            _solver.Inputs.Colliders.Add(Box);
+        } });
+        Features.Add({ TEXT("Burn"), [](ClothSolverSettings&) {}, [](ClothSolver& _solver)
+        {
+            for (int32 i = 0; i < 8; i++)
+            {
+                _solver.BurnFront.Ignite(_solver.Particles, FMath::RandRange(0, _solver.Particles.Num() - 1), 0.5f);
+            }
+        } });
+        return Features;
+    }
+
+    // Times a hash rebuild and resolve on a crumpled square grid, returns its JSON result
+    FString RunSelfCollision(int32 _numParticles, int32 _runs)
+    {
+        const int32 Side = FMath::Max(FMath::CeilToInt(FMath::Sqrt((float)_numParticles)), 3);
+
+        const float Spacing = 2.0f;
+        const float Thickness = Spacing * 0.5f;
+
+        const int32 NumParticles = Side * Side;
+        const int32 MaxConstraints = (Side - 1) * Side * 2;
+
+        ClothArena Arena;
+        Arena.Initialise(ClothParticleStore::ArenaSize(NumParticles) + ClothConstraintStore::ArenaSize(MaxConstraints, NumParticles));
+
+        ClothParticleStore Particles;
+        Particles.Initialise(Arena, Side, Side);
+        for (int32 i = 0; i < Particles.Num(); i++)
+        {
+            Particles.SetInitialPosition(i, FVector3f((i % Side) * Spacing, (i / Side) * Spacing, 0.0f));
+        }
+
+        ClothConstraintStore Constraints;
+        Constraints.Initialise(Arena, MaxConstraints, NumParticles);
+        for (int32 Vert = 0; Vert < Side; Vert++)
+        {
+            for (int32 Horz = 0; Horz < Side; Horz++)
+            {
+                const int32 Index = Particles.GetIndex(Horz, Vert);
+                if (Horz < Side - 1) Constraints.Add(Particles, Index, Index + 1, EClothLinks::Right);
+                if (Vert < Side - 1) Constraints.Add(Particles, Index, Index + Side, EClothLinks::Down);
+            }
+        }
+        Constraints.BuildParticleLinks(Side, Side);
+
+        // A random crumple, dense enough that most cells are occupied
+        FRandomStream Random(1234);
+        const float Extent = Side * Spacing * 0.25f;
+        for (int32 i = 0; i < Particles.Num(); i++)
+        {
+            Particles.Positions[i] = FVector3f(Random.FRandRange(0.0f, Extent), Random.FRandRange(0.0f, Extent), Random.FRandRange(0.0f, Extent * 0.1f));
+        }
+
+        ClothSelfCollision SelfCollision;
+        SelfCollision.Build(Particles.Positions, Thickness);
+        SelfCollision.Resolve(Particles, Constraints);
+
+        double BuildSeconds = 0.0;
+        double ResolveSeconds = 0.0;
+        int32 Contacts = 0;
+
+        for (int32 Run = 0; Run < _runs; Run++)
+        {
+            const double Start = FPlatformTime::Seconds();
+            SelfCollision.Build(Particles.Positions, Thickness);
+            const double Built = FPlatformTime::Seconds();
+            Contacts = SelfCollision.Resolve(Particles, Constraints);
+            const double Resolved = FPlatformTime::Seconds();
+
+            BuildSeconds += Built - Start;
+            ResolveSeconds += Resolved - Built;
+        }
+
+        UE_LOG(LogClothBenchmark, Display, TEXT("%-16s %d particles: build %.3f ms, resolve %.3f ms, %d contacts"),
+            TEXT("SelfCollisionKernel"), NumParticles, BuildSeconds * 1000.0 / _runs, ResolveSeconds * 1000.0 / _runs, Contacts);
+
+        return FString::Printf(TEXT("    { \"feature\": \"SelfCollisionKernel\", \"grid\": %d, \"particles\": %d, \"runs\": %d, ")
+            TEXT("\"build_ms\": %.4f, \"resolve_ms\": %.4f, \"contacts\": %d }"),
+            Side, NumParticles, _runs, BuildSeconds * 1000.0 / _runs, ResolveSeconds * 1000.0 / _runs, Contacts);
+    }
+
+    TArray<int32> ParseIntList(const TCHAR* _commandLine, const TCHAR* _key, const TArray<int32>& _default)
+    {
+        FString Value;
+        if (!FParse::Value(_commandLine, _key, Value, false))
+        {
+            return _default;
+        }
+
+        TArray<FString> Parts;
+        Value.ParseIntoArray(Parts, TEXT(","));
+
+        TArray<int32> Result;
+        for (const FString& Part : Parts)
+        {
+            Result.Add(FCString::Atoi(*Part));
+        }
+        return Result;
+    }
+
+    int32 Run(const TCHAR* _commandLine)
+    {
+        const TArray<int32> Sizes = ParseIntList(_commandLine, TEXT("Sizes="), { 30, 64, 128, 256, 512 });
+        const TArray<int32> Substeps = ParseIntList(_commandLine, TEXT("Substeps="), { 1, 5, 10 });
+
+        int32 Steps = 60;
+        int32 Warmup = 10;
+        FParse::Value(_commandLine, TEXT("Steps="), Steps);
+        FParse::Value(_commandLine, TEXT("Warmup="), Warmup);
+        Steps = FMath::Max(Steps, 1);
+
+        FString FeatureFilter;
+        TArray<FString> EnabledFeatures;
+        if (FParse::Value(_commandLine, TEXT("Features="), FeatureFilter, false))
+        {
+            FeatureFilter.ParseIntoArray(EnabledFeatures, TEXT(","));
+        }
+
+        FString Json = FString::Printf(TEXT("{\n  \"steps\": %d,\n  \"warmup\": %d,\n  \"results\": ["), Steps, Warmup);
+        bool First = true;
+
+        for (const FFeature& Feature : MakeFeatures())
+        {
+            if (EnabledFeatures.Num() > 0 && !EnabledFeatures.Contains(Feature.Name))
+            {
+                continue;
+            }
+
+            for (int32 Size : Sizes)
+            {
+                for (int32 Substep : Substeps)
+                {
+                    // Same ignition points every run, the solver itself is seeded through its settings
+                    FMath::RandInit(1234);
+
+                    ClothSolver Solver;
+                    Solver.Settings.NumHorzParticles = Size;
+                    Solver.Settings.NumVertParticles = Size;
+                    Solver.Settings.UpdateSteps = Substep;
+                    // A resting grid would fall asleep partway through a long run, so sleeping is timed as its own feature
+                    Solver.Settings.AllowSleeping = false;
+                    Feature.Configure(Solver.Settings);
+
+                    Solver.Build();
+                    Solver.Constrict(1.0f);
+                    Solver.Inputs.WindVector = FVector3f(50.0f, 600.0f, 100.0f).GetSafeNormal() * 500.0f;
+                    Solver.Inputs.GroundHeight = -Solver.Settings.ClothHeight * 2.0f;
+                    Feature.Prepare(Solver);
+
+                    for (int32 Step = 0; Step < Warmup; Step++)
+                    {
+                        Solver.Step();
+                    }
+
+                    TArray<double> StepTimes;
+                    StepTimes.Reserve(Steps);
+                    for (int32 Step = 0; Step < Steps; Step++)
+                    {
+                        const uint64 Start = FPlatformTime::Cycles64();
+                        Solver.Step();
+                        StepTimes.Add(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - Start) * 1.0e9);
+                    }
+
+                    StepTimes.Sort();
+                    double Total = 0.0;
+                    for (double Time : StepTimes)
+                    {
+                        Total += Time;
+                    }
+
+                    const int32 NumParticles = Solver.Particles.Num();
+                    const double MeanNs = Total / Steps;
+                    const double MedianNs = StepTimes[Steps / 2];
+
+                    int32 Broken = 0;
+                    for (int32 i = 0; i < Solver.Constraints.Num(); i++)
+                    {
+                        Broken += Solver.Constraints.GetEnabled(i) ? 0 : 1;
+                    }
+
+                    UE_LOG(LogClothBenchmark, Display, TEXT("%-16s %4dx%-4d substeps %2d: %8.2f ns/particle/step"),
+                        Feature.Name, Size, Size, Substep, MedianNs / NumParticles);
+
+                    Json += First ? TEXT("\n") : TEXT(",\n");
+                    Json += FString::Printf(TEXT("    { \"feature\": \"%s\", \"grid\": %d, \"particles\": %d, \"constraints\": %d, \"substeps\": %d, ")
+                        TEXT("\"ns_per_particle_step\": %.3f, \"mean_ns_per_particle_step\": %.3f, \"min_step_ms\": %.4f, \"max_step_ms\": %.4f, ")
+                        TEXT("\"solver_iterations\": %d, \"broken_constraints\": %d }"),
+                        Feature.Name, Size, NumParticles, Solver.Constraints.Num(), Substep,
+                        MedianNs / NumParticles, MeanNs / NumParticles, StepTimes[0] * 1.0e-6, StepTimes.Last() * 1.0e-6,
+                        Solver.LastSolverIterations, Broken);
+                    First = false;
+                }
+            }
+        }
+
+        if (EnabledFeatures.Num() == 0 || EnabledFeatures.Contains(TEXT("SelfCollisionKernel")))
+        {
+            int32 SelfCollisionParticles = 100000;
+            FParse::Value(_commandLine, TEXT("SelfCollisionParticles="), SelfCollisionParticles);
+
+            Json += First ? TEXT("\n") : TEXT(",\n");
+            Json += RunSelfCollision(SelfCollisionParticles, Steps);
+            First = false;
+        }
+
+        Json += TEXT("\n  ]\n}\n");
+
+        FString OutputPath;
+        if (FParse::Value(_commandLine, TEXT("Output="), OutputPath) && !FFileHelper::SaveStringToFile(Json, *OutputPath))
+        {
+            UE_LOG(LogClothBenchmark, Error, TEXT("Could not write %s"), *OutputPath);
+            return 1;
+        }
+
+        FPlatformMisc::LocalPrint(*Json);
+        return 0;
+    }
+}
+
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+    FTaskTagScope Scope(ETaskTag::EGameThread);
+
+    // Brings up the task graph the parallel solver paths run on
+    if (int32 Result = GEngineLoop.PreInit(ArgC, ArgV))
+    {
+        return Result;
+    }
+
+    const int32 Result = ClothBenchmark::Run(FCommandLine::Get());
+
+    RequestEngineExit(TEXT("ClothBenchmark finished"));
+    FEngineLoop::AppPreExit();
+    FModuleManager::Get().UnloadModulesAtShutdown();
+    FEngineLoop::AppExit();
+    return Result;
+}
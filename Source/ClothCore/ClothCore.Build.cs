@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class ClothCore : ModuleRules
+{
+	public ClothCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// The solver has to build without the engine, so it can run in ClothBenchmark
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothActiveConstraints.h"
+#include "ClothConstraintStore.h"
+#include "ClothParticleStore.h"
+#include "Algo/Reverse.h"
+
+void ClothActiveConstraints::Initialise(int32 _numVert, int32 _seed)
+{
+    Empty();
+
+    FRandomStream Random(_seed);
+
+    // Top to bottom and back again, so corrections don't always travel the same way
+    Ordering& Forward = Orderings.AddDefaulted_GetRef();
+    Ordering& Backward = Orderings.AddDefaulted_GetRef();
+    for (int32 Row = 0; Row < _numVert; Row++)
+    {
+        Forward.Rows.Add(Row);
+        Backward.Rows.Add(_numVert - 1 - Row);
+    }
+    Backward.Reverse = true;
+
+    // Red-black, even rows then odd rows, and the reverse
+    Ordering& RedBlack = Orderings.AddDefaulted_GetRef();
+    for (int32 Parity = 0; Parity < 2; Parity++)
+    {
+        for (int32 Row = Parity; Row < _numVert; Row += 2)
+        {
+            RedBlack.Rows.Add(Row);
+        }
+    }
+    Ordering& BlackRed = Orderings.AddDefaulted_GetRef();
+    BlackRed.Rows = RedBlack.Rows;
+    Algo::Reverse(BlackRed.Rows);
+    BlackRed.Reverse = true;
+
+    // Rows in a seeded random order, each still swept in memory order
+    Ordering& Seeded = Orderings.AddDefaulted_GetRef();
+    Seeded.Rows = Forward.Rows;
+    for (int32 i = Seeded.Rows.Num() - 1; i > 0; i--)
+    {
+        Seeded.Rows.Swap(i, Random.RandRange(0, i));
+    }
+
+    FirstOrdering = Random.RandRange(0, Orderings.Num() - 1);
+    Restart();
+}
+
+void ClothActiveConstraints::Empty()
+{
+    Free.Empty();
+    MovesA.Empty();
+    MovesB.Empty();
+    Orderings.Empty();
+    RowStarts.Empty();
+    MovesARowStarts.Empty();
+    MovesBRowStarts.Empty();
+    RowCursors.Empty();
+    ParticleStarts.Empty();
+
+    FirstOrdering = 0;
+    NextOrderingIndex = 0;
+    TopologyVersion = INDEX_NONE;
+}
+
+void ClothActiveConstraints::Restart()
+{
+    NextOrderingIndex = FirstOrdering;
+}
+
+const ClothActiveConstraints::Ordering& ClothActiveConstraints::NextOrdering()
+{
+    const Ordering& Result = Orderings[NextOrderingIndex];
+    NextOrderingIndex = (NextOrderingIndex + 1) % Orderings.Num();
+    return Result;
+}
+
+void ClothActiveConstraints::Update(const ClothConstraintStore& _constraints, const ClothParticleStore& _particles, bool _includeInterwoven)
+{
+    if (TopologyVersion == _constraints.GetTopologyVersion() && MobilityVersion == _particles.GetMobilityVersion() &&
+        IncludeInterwoven == _includeInterwoven)
+    {
+        return;
+    }
+
+    TopologyVersion = _constraints.GetTopologyVersion();
+    MobilityVersion = _particles.GetMobilityVersion();
+    IncludeInterwoven = _includeInterwoven;
+
+    const int32 NumParticles = _particles.Num();
+    const int32 NumHorz = _particles.GetNumHorz();
+    const int32 NumVert = _particles.GetNumVert();
+
+    // Sized once, later rebuilds reuse the memory
+    ParticleStarts.Reset();
+    ParticleStarts.SetNumZeroed(NumParticles + 1);
+    MovesARowStarts.Reset();
+    MovesARowStarts.SetNumZeroed(NumVert + 1);
+    MovesBRowStarts.Reset();
+    MovesBRowStarts.SetNumZeroed(NumVert + 1);
+
+    enum class EKind { Skip, Free, MovesA, MovesB };
+    auto Classify = [&](int32 _constraint)
+    {
+        if (!_constraints.GetEnabled(_constraint) || (_constraints.GetInterwoven(_constraint) && !_includeInterwoven))
+        {
+            return EKind::Skip;
+        }
+
+        const bool MoveA = _particles.IsMovable(_constraints.ParticleA[_constraint]);
+        const bool MoveB = _particles.IsMovable(_constraints.ParticleB[_constraint]);
+        return MoveA && MoveB ? EKind::Free : (MoveA ? EKind::MovesA : (MoveB ? EKind::MovesB : EKind::Skip));
+    };
+
+    // Count the free constraints each particle owns, and the ones with a fixed end each row owns
+    int32 NumFree = 0;
+    int32 NumMovesA = 0;
+    int32 NumMovesB = 0;
+    for (int32 i = 0; i < _constraints.Num(); i++)
+    {
+        const int32 Owner = _constraints.ParticleA[i];
+        switch (Classify(i))
+        {
+        case EKind::Free:
+            ParticleStarts[Owner + 1]++;
+            NumFree++;
+            break;
+        case EKind::MovesA:
+            MovesARowStarts[Owner / NumHorz + 1]++;
+            NumMovesA++;
+            break;
+        case EKind::MovesB:
+            MovesBRowStarts[Owner / NumHorz + 1]++;
+            NumMovesB++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    for (int32 Particle = 0; Particle < NumParticles; Particle++)
+    {
+        ParticleStarts[Particle + 1] += ParticleStarts[Particle];
+    }
+
+    // Rows are contiguous runs of particles, so their ranges fall out of the particle ranges
+    RowStarts.SetNumUninitialized(NumVert + 1, false);
+    for (int32 Row = 0; Row <= NumVert; Row++)
+    {
+        RowStarts[Row] = ParticleStarts[Row * NumHorz];
+    }
+
+    // The fixed end lists are bucketed by row the same way, with a cursor per row for the scatter
+    for (int32 Row = 0; Row < NumVert; Row++)
+    {
+        MovesARowStarts[Row + 1] += MovesARowStarts[Row];
+        MovesBRowStarts[Row + 1] += MovesBRowStarts[Row];
+    }
+    RowCursors.SetNumUninitialized(NumVert * 2, false);
+    for (int32 Row = 0; Row < NumVert; Row++)
+    {
+        RowCursors[Row] = MovesARowStarts[Row];
+        RowCursors[NumVert + Row] = MovesBRowStarts[Row];
+    }
+
+    // Scatter into place, ParticleStarts becomes the write cursor of each particle
+    Free.SetNumUninitialized(NumFree, false);
+    MovesA.SetNumUninitialized(NumMovesA, false);
+    MovesB.SetNumUninitialized(NumMovesB, false);
+    for (int32 i = 0; i < _constraints.Num(); i++)
+    {
+        const int32 Owner = _constraints.ParticleA[i];
+        switch (Classify(i))
+        {
+        case EKind::Free:
+            Free[ParticleStarts[Owner]++] = i;
+            break;
+        case EKind::MovesA:
+            MovesA[RowCursors[Owner / NumHorz]++] = i;
+            break;
+        case EKind::MovesB:
+            MovesB[RowCursors[NumVert + Owner / NumHorz]++] = i;
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothAerodynamics.h"
+#include "ClothParticleStore.h"
+#include "ClothSurface.h"
+#include "ClothWindField.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+    enum ECorner
+    {
+        TopLeft,
+        TopRight,
+        BottomLeft,
+        BottomRight,
+        NumCorners,
+    };
+}
+
+void ClothAerodynamics::Initialise(int32 _numHorz, int32 _numVert)
+{
+    NumHorz = _numHorz;
+    NumVert = _numVert;
+
+    Forces.SetNumZeroed(NumHorz * NumVert);
+    CornerForces.SetNumZeroed(NumHorz * NumVert * NumCorners);
+}
+
+void ClothAerodynamics::Empty()
+{
+    Forces.Empty();
+    CornerForces.Empty();
+
+    NumHorz = 0;
+    NumVert = 0;
+}
+
+FVector3f ClothAerodynamics::TriangleForce(const FVector3f& _a, const FVector3f& _b, const FVector3f& _c, const FVector3f& _relativeWind) const
+{
+    const float WindSpeed = _relativeWind.Size();
+    const FVector3f AreaNormal = FVector3f::CrossProduct(_b - _a, _c - _a) * 0.5f;
+    const float Area = AreaNormal.Size();
+
+    if (WindSpeed <= UE_KINDA_SMALL_NUMBER || Area <= UE_KINDA_SMALL_NUMBER)
+    {
+        return FVector3f::ZeroVector;
+    }
+
+    const FVector3f WindDirection = _relativeWind / WindSpeed;
+    FVector3f Normal = AreaNormal / Area;
+
+    // Face the normal into the wind, cloth is double sided
+    float CosAngle = FVector3f::DotProduct(Normal, WindDirection);
+    if (CosAngle < 0.0f)
+    {
+        Normal = -Normal;
+        CosAngle = -CosAngle;
+    }
+
+    const float DynamicPressure = 0.5f * Density * WindSpeed * WindSpeed * Area;
+
+    // Drag along the wind, scaled by how much of the triangle faces it
+    FVector3f Force = WindDirection * (DragCoefficient * DynamicPressure * CosAngle);
+
+    // Lift perpendicular to the wind, strongest at 45 degrees and zero face on or edge on
+    const FVector3f LiftDirection = (Normal - WindDirection * CosAngle).GetSafeNormal();
+    const float SinAngle = FMath::Sqrt(FMath::Max(1.0f - CosAngle * CosAngle, 0.0f));
+    Force += LiftDirection * (LiftCoefficient * DynamicPressure * CosAngle * SinAngle);
+
+    return Force;
+}
+
+void ClothAerodynamics::Compute(const ClothParticleStore& _particles, const ClothSurface& _surface, const FVector3f& _uniformWind,
+    const ClothWindField* _windField, const FVector3f& _worldOffset, float _deltaTime)
+{
+    const TConstArrayView<FVector3f> Positions = _particles.Positions;
+    const TConstArrayView<FVector3f> PreviousPositions = _particles.PreviousPositions;
+    const TArray<uint8>& CellTriangles = _surface.GetCellTriangles();
+    const float InvDeltaTime = 1.0f / _deltaTime;
+    const float OneThird = 1.0f / 3.0f;
+
+    ParallelFor(NumVert - 1, [&](int32 Vert)
+    {
+        for (int32 Horz = 0; Horz < NumHorz - 1; Horz++)
+        {
+            const int32 Cell = Horz + Vert * NumHorz;
+            const uint8 Triangles = CellTriangles[Cell];
+            FVector3f* Corners = &CornerForces[Cell * NumCorners];
+
+            for (int32 Corner = 0; Corner < NumCorners; Corner++)
+            {
+                Corners[Corner] = FVector3f::ZeroVector;
+            }
+
+            if (Triangles == EClothCellTriangles::None)
+            {
+                continue;
+            }
+
+            const int32 Indices[NumCorners] = { Cell, Cell + 1, Cell + NumHorz, Cell + NumHorz + 1 };
+            FVector3f CellPositions[NumCorners];
+            FVector3f CellVelocity = FVector3f::ZeroVector;
+            for (int32 Corner = 0; Corner < NumCorners; Corner++)
+            {
+                CellPositions[Corner] = Positions[Indices[Corner]];
+                CellVelocity += (Positions[Indices[Corner]] - PreviousPositions[Indices[Corner]]) * InvDeltaTime;
+            }
+            CellVelocity *= 0.25f;
+
+            // One wind sample per cell, shared by both triangles
+            FVector3f Wind = _uniformWind;
+            if (_windField != nullptr)
+            {
+                const FVector3f CellCenter = (CellPositions[TopLeft] + CellPositions[BottomRight]) * 0.5f;
+                Wind += _windField->Sample(CellCenter + _worldOffset);
+            }
+            const FVector3f RelativeWind = Wind - CellVelocity;
+
+            auto AddTriangle = [&](int32 _a, int32 _b, int32 _c)
+            {
+                const FVector3f Share = TriangleForce(CellPositions[_a], CellPositions[_b], CellPositions[_c], RelativeWind) * OneThird;
+                Corners[_a] += Share;
+                Corners[_b] += Share;
+                Corners[_c] += Share;
+            };
+
+            if (Triangles & EClothCellTriangles::TopLeft_TopRight_BottomLeft)
+            {
+                AddTriangle(TopLeft, TopRight, BottomLeft);
+            }
+            else if (Triangles & EClothCellTriangles::BottomLeft_TopLeft_BottomRight)
+            {
+                AddTriangle(BottomLeft, TopLeft, BottomRight);
+            }
+
+            if (Triangles & EClothCellTriangles::TopRight_BottomRight_BottomLeft)
+            {
+                AddTriangle(TopRight, BottomRight, BottomLeft);
+            }
+            else if (Triangles & EClothCellTriangles::TopRight_BottomRight_TopLeft)
+            {
+                AddTriangle(TopRight, BottomRight, TopLeft);
+            }
+        }
+    });
+
+    // Gather from the cells around each particle, a particle is the opposite corner of each of them
+    ParallelFor(NumVert, [&](int32 Vert)
+    {
+        for (int32 Horz = 0; Horz < NumHorz; Horz++)
+        {
+            const int32 Index = Horz + Vert * NumHorz;
+            FVector3f Force = FVector3f::ZeroVector;
+
+            const bool HasLeft = Horz > 0;
+            const bool HasRight = Horz < NumHorz - 1;
+            const bool HasUp = Vert > 0;
+            const bool HasDown = Vert < NumVert - 1;
+
+            if (HasUp && HasLeft)   Force += CornerForces[(Index - NumHorz - 1) * NumCorners + BottomRight];
+            if (HasUp && HasRight)  Force += CornerForces[(Index - NumHorz) * NumCorners + BottomLeft];
+            if (HasDown && HasLeft) Force += CornerForces[(Index - 1) * NumCorners + TopRight];
+            if (HasDown && HasRight) Force += CornerForces[Index * NumCorners + TopLeft];
+
+            Forces[Index] = Force;
+        }
+    });
+}
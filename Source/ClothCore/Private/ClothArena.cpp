@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothArena.h"
+
+ClothArena::~ClothArena()
+{
+    Empty();
+}
+
+void ClothArena::Initialise(SIZE_T _size)
+{
+    Empty();
+
+    Size = _size;
+    Block = static_cast<uint8*>(FMemory::Malloc(FMath::Max<SIZE_T>(Size, 1), Alignment));
+    FMemory::Memzero(Block, Size);
+}
+
+void ClothArena::Empty()
+{
+    FMemory::Free(Block);
+    FMemory::Free(Snapshot);
+
+    Block = nullptr;
+    Snapshot = nullptr;
+    Size = 0;
+    Used = 0;
+}
+
+void ClothArena::CaptureSnapshot()
+{
+    if (Snapshot == nullptr)
+    {
+        Snapshot = static_cast<uint8*>(FMemory::Malloc(FMath::Max<SIZE_T>(Size, 1), Alignment));
+    }
+    FMemory::Memcpy(Snapshot, Block, Size);
+}
+
+void ClothArena::RestoreSnapshot()
+{
+    check(Snapshot != nullptr);
+    FMemory::Memcpy(Block, Snapshot, Size);
+}
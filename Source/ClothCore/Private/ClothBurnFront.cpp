@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothBurnFront.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+
+void ClothBurnFront::Initialise(int32 _numParticles, int32 _seed)
+{
+    Random.Initialize(_seed);
+
+    Active.Reset();
+    Active.Reserve(_numParticles);
+    Ignited.Reset();
+    Ignited.Reserve(_numParticles);
+}
+
+void ClothBurnFront::Empty()
+{
+    Active.Empty();
+    Ignited.Empty();
+}
+
+void ClothBurnFront::Ignite(ClothParticleStore& _particles, int32 _index, float _burnAmount)
+{
+    _particles.AddBurn(_index, _burnAmount);
+
+    if (!(_particles.Flags[_index] & EClothParticleFlags::Burning))
+    {
+        _particles.Flags[_index] |= EClothParticleFlags::Burning;
+        Active.Add(_index);
+    }
+}
+
+void ClothBurnFront::UpdateBurn(ClothParticleStore& _particles, ClothConstraintStore& _constraints, float _deltaTime)
+{
+    const float BurnRate = _particles.GetBurnRate();
+
+    for (int32 Particle : Active)
+    {
+        _particles.AddBurn(Particle, BurnRate * _deltaTime);
+
+        const float BurnAmount = _particles.BurnAmounts[Particle];
+        if (BurnAmount > SpreadThreshold)
+        {
+            // Burning damages the constraints attached to nearly burnt particles
+            const float ConstraintDamage = (BurnRate * _deltaTime + BurnAmount) * _deltaTime;
+
+            _constraints.ForEachAttachedConstraint(Particle, [&_constraints, ConstraintDamage](int32 _constraint)
+            {
+                _constraints.TakeDamage(_constraint, ConstraintDamage);
+            });
+        }
+    }
+}
+
+void ClothBurnFront::Propagate(ClothParticleStore& _particles, const ClothConstraintStore& _constraints)
+{
+    if (Active.Num() == 0)
+    {
+        return;
+    }
+
+    const int32 NumHorz = _particles.GetNumHorz();
+    const int32 NumVert = _particles.GetNumVert();
+
+    Ignited.Reset();
+
+    // Compact in place, keeping the particles the fire still has work to do on
+    int32 NumKept = 0;
+    for (int32 i = 0; i < Active.Num(); i++)
+    {
+        const int32 Particle = Active[i];
+        const int32 Horz = Particle % NumHorz;
+        const int32 Vert = Particle / NumHorz;
+        const float BurnAmount = _particles.BurnAmounts[Particle];
+
+        // Find the unburnt neighbours, diagonals included
+        int32 Neighbors[8];
+        int32 NumNeighbors = 0;
+
+        for (int32 dVert = -1; dVert <= 1; dVert++)
+        {
+            for (int32 dHorz = -1; dHorz <= 1; dHorz++)
+            {
+                const int32 NeighborHorz = Horz + dHorz;
+                const int32 NeighborVert = Vert + dVert;
+
+                if ((dVert == 0 && dHorz == 0) || NeighborHorz < 0 || NeighborHorz >= NumHorz || NeighborVert < 0 || NeighborVert >= NumVert)
+                {
+                    continue;
+                }
+
+                const int32 Neighbor = _particles.GetIndex(NeighborHorz, NeighborVert);
+                if (_particles.BurnAmounts[Neighbor] <= UnburntThreshold)
+                {
+                    Neighbors[NumNeighbors++] = Neighbor;
+                }
+            }
+        }
+
+        // Propagate to one random valid neighbor
+        if (BurnAmount >= SpreadThreshold && NumNeighbors > 0 && Random.FRand() <= SpreadChance)
+        {
+            const int32 Neighbor = Neighbors[Random.RandRange(0, NumNeighbors - 1)];
+            _particles.AddBurn(Neighbor, IgniteAmount);
+
+            if (!(_particles.Flags[Neighbor] & EClothParticleFlags::Burning))
+            {
+                _particles.Flags[Neighbor] |= EClothParticleFlags::Burning;
+                Ignited.Add(Neighbor);
+            }
+        }
+
+        bool HasConstraints = false;
+        _constraints.ForEachAttachedConstraint(Particle, [&HasConstraints](int32)
+        {
+            HasConstraints = true;
+        });
+
+        // Fully burnt with nothing left to damage or spread to
+        const bool Finished = BurnAmount >= 1.0f && !HasConstraints && NumNeighbors == 0;
+        if (Finished)
+        {
+            _particles.Flags[Particle] &= ~EClothParticleFlags::Burning;
+        }
+        else
+        {
+            Active[NumKept++] = Particle;
+        }
+    }
+
+    Active.SetNum(NumKept, false);
+    Active.Append(Ignited);
+}
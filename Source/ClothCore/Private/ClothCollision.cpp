@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothCollision.h"
+#include "ClothParticleStore.h"
+#include "Async/ParallelFor.h"
+
+void ClothCollider::UpdateBounds()
+{
+    switch (Type)
+    {
+    case EClothColliderType::Sphere:
+        Bounds = FBox3f(Center - FVector3f(Radius), Center + FVector3f(Radius));
+        break;
+    case EClothColliderType::Capsule:
+    {
+        // Either end can be the lower one on each axis once the capsule is tilted
+        const FVector3f Axis = (Rotation.GetAxisZ() * HalfHeight).GetAbs();
+        Bounds = FBox3f(Center - Axis, Center + Axis).ExpandBy(Radius);
+        break;
+    }
+    case EClothColliderType::Plane:
+        // Infinite, the grid clamps it to the cloth
+        Bounds = FBox3f(FVector3f(-UE_BIG_NUMBER), FVector3f(UE_BIG_NUMBER));
+        break;
+    case EClothColliderType::Box:
+    {
+        FVector3f Extent = FVector3f::ZeroVector;
+        for (int32 Axis = 0; Axis < 3; Axis++)
+        {
+            FVector3f Direction = FVector3f::ZeroVector;
+            Direction[Axis] = HalfExtents[Axis];
+            Extent += Rotation.RotateVector(Direction).GetAbs();
+        }
+        Bounds = FBox3f(Center - Extent, Center + Extent);
+        break;
+    }
+    }
+}
+
+void ClothCollider::Translate(const FVector3f& _offset)
+{
+    Center += _offset;
+    Bounds = Bounds.ShiftBy(_offset);
+}
+
+bool ClothCollider::ResolvePoint(FVector3f& _position) const
+{
+    switch (Type)
+    {
+    case EClothColliderType::Sphere:
+    {
+        FVector3f Direction = _position - Center;
+        if (Direction.SizeSquared() < Radius * Radius)
+        {
+            // Move the particle to the sphere's surface
+            Direction.Normalize();
+            _position = Direction * Radius + Center;
+            return true;
+        }
+        return false;
+    }
+    case EClothColliderType::Capsule:
+    {
+        const FVector3f Axis = Rotation.GetAxisZ();
+        const float Along = FMath::Clamp(FVector3f::DotProduct(_position - Center, Axis), -HalfHeight, HalfHeight);
+        const FVector3f Closest = Center + Axis * Along;
+
+        FVector3f Direction = _position - Closest;
+        if (Direction.SizeSquared() < Radius * Radius)
+        {
+            Direction.Normalize();
+            _position = Direction * Radius + Closest;
+            return true;
+        }
+        return false;
+    }
+    case EClothColliderType::Plane:
+    {
+        const FVector3f Normal = Rotation.GetAxisZ();
+        const float Distance = FVector3f::DotProduct(_position - Center, Normal);
+        if (Distance < 0.0f)
+        {
+            _position -= Normal * Distance;
+            return true;
+        }
+        return false;
+    }
+    case EClothColliderType::Box:
+    {
+        const FVector3f Local = Rotation.UnrotateVector(_position - Center);
+
+        // Inside when within every half extent, leave through the closest face
+        int32 ExitAxis = INDEX_NONE;
+        float ExitDepth = UE_BIG_NUMBER;
+        for (int32 Axis = 0; Axis < 3; Axis++)
+        {
+            const float Depth = HalfExtents[Axis] - FMath::Abs(Local[Axis]);
+            if (Depth <= 0.0f)
+            {
+                return false;
+            }
+            if (Depth < ExitDepth)
+            {
+                ExitDepth = Depth;
+                ExitAxis = Axis;
+            }
+        }
+
+        FVector3f Pushed = Local;
+        Pushed[ExitAxis] = Local[ExitAxis] >= 0.0f ? HalfExtents[ExitAxis] : -HalfExtents[ExitAxis];
+        _position = Rotation.RotateVector(Pushed) + Center;
+        return true;
+    }
+    }
+    return false;
+}
+
+void ClothColliderGrid::Build(const TArray<ClothCollider>& _colliders, const FBox3f& _clothBounds)
+{
+    Colliders = &_colliders;
+    GridBounds = _clothBounds;
+
+    if (_colliders.Num() < MinCollidersForGrid || !_clothBounds.IsValid)
+    {
+        Dimensions = FIntVector(1, 1, 1);
+        InvCellSize = FVector3f::ZeroVector;
+    }
+    else
+    {
+        const FVector3f Size = _clothBounds.GetSize();
+        const float CellSize = FMath::Max(Size.GetMax() / MaxCellsPerAxis, 1.0f);
+        Dimensions = FIntVector(
+            FMath::Clamp(FMath::CeilToInt(Size.X / CellSize), 1, MaxCellsPerAxis),
+            FMath::Clamp(FMath::CeilToInt(Size.Y / CellSize), 1, MaxCellsPerAxis),
+            FMath::Clamp(FMath::CeilToInt(Size.Z / CellSize), 1, MaxCellsPerAxis));
+        InvCellSize = FVector3f(Dimensions.X / FMath::Max(Size.X, UE_SMALL_NUMBER),
+            Dimensions.Y / FMath::Max(Size.Y, UE_SMALL_NUMBER),
+            Dimensions.Z / FMath::Max(Size.Z, UE_SMALL_NUMBER));
+    }
+
+    const int32 NumCells = Dimensions.X * Dimensions.Y * Dimensions.Z;
+    CellStarts.Reset();
+    CellStarts.SetNumZeroed(NumCells + 1);
+    CellColliders.Reset();
+
+    // Cell range each collider covers, clamped to the grid
+    auto ForEachCoveredCell = [this](const ClothCollider& _collider, auto&& _function)
+    {
+        const FBox3f Overlap = _collider.Bounds.Overlap(GridBounds);
+        if (!Overlap.IsValid)
+        {
+            return;
+        }
+
+        const FIntVector Min(
+            FMath::Clamp(FMath::FloorToInt((Overlap.Min.X - GridBounds.Min.X) * InvCellSize.X), 0, Dimensions.X - 1),
+            FMath::Clamp(FMath::FloorToInt((Overlap.Min.Y - GridBounds.Min.Y) * InvCellSize.Y), 0, Dimensions.Y - 1),
+            FMath::Clamp(FMath::FloorToInt((Overlap.Min.Z - GridBounds.Min.Z) * InvCellSize.Z), 0, Dimensions.Z - 1));
+        const FIntVector Max(
+            FMath::Clamp(FMath::FloorToInt((Overlap.Max.X - GridBounds.Min.X) * InvCellSize.X), 0, Dimensions.X - 1),
+            FMath::Clamp(FMath::FloorToInt((Overlap.Max.Y - GridBounds.Min.Y) * InvCellSize.Y), 0, Dimensions.Y - 1),
+            FMath::Clamp(FMath::FloorToInt((Overlap.Max.Z - GridBounds.Min.Z) * InvCellSize.Z), 0, Dimensions.Z - 1));
+
+        for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+        {
+            for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+            {
+                for (int32 X = Min.X; X <= Max.X; X++)
+                {
+                    _function(X + Dimensions.X * (Y + Dimensions.Y * Z));
+                }
+            }
+        }
+    };
+
+    // Count, prefix sum, then fill
+    for (const ClothCollider& Collider : _colliders)
+    {
+        ForEachCoveredCell(Collider, [this](int32 _cell) { CellStarts[_cell + 1]++; });
+    }
+    for (int32 Cell = 0; Cell < NumCells; Cell++)
+    {
+        CellStarts[Cell + 1] += CellStarts[Cell];
+    }
+
+    CellColliders.SetNumUninitialized(CellStarts[NumCells], false);
+
+    TArray<int32, TInlineAllocator<512>> Cursor;
+    Cursor.Append(CellStarts.GetData(), NumCells);
+    for (int32 i = 0; i < _colliders.Num(); i++)
+    {
+        ForEachCoveredCell(_colliders[i], [&](int32 _cell) { CellColliders[Cursor[_cell]++] = i; });
+    }
+}
+
+int32 ClothColliderGrid::CellIndex(const FVector3f& _position) const
+{
+    const int32 X = FMath::Clamp(FMath::FloorToInt((_position.X - GridBounds.Min.X) * InvCellSize.X), 0, Dimensions.X - 1);
+    const int32 Y = FMath::Clamp(FMath::FloorToInt((_position.Y - GridBounds.Min.Y) * InvCellSize.Y), 0, Dimensions.Y - 1);
+    const int32 Z = FMath::Clamp(FMath::FloorToInt((_position.Z - GridBounds.Min.Z) * InvCellSize.Z), 0, Dimensions.Z - 1);
+    return X + Dimensions.X * (Y + Dimensions.Y * Z);
+}
+
+int32 ClothColliderGrid::Resolve(ClothParticleStore& _particles) const
+{
+    if (Colliders == nullptr || CellColliders.Num() == 0)
+    {
+        return 0;
+    }
+
+    const TArray<ClothCollider>& ColliderList = *Colliders;
+    TArrayView<FVector3f> Positions = _particles.Positions;
+
+    const int32 ChunkSize = 1024;
+    const int32 NumChunks = FMath::DivideAndRoundUp(Positions.Num(), ChunkSize);
+    int32 Contacts = 0;
+
+    ParallelFor(NumChunks, [&](int32 Chunk)
+    {
+        const int32 First = Chunk * ChunkSize;
+        const int32 Last = FMath::Min(First + ChunkSize, Positions.Num());
+        int32 ChunkContacts = 0;
+
+        for (int32 i = First; i < Last; i++)
+        {
+            // Anything close enough to touch a sleeping particle has already woken it
+            if (_particles.GetSleeping(i))
+            {
+                continue;
+            }
+
+            const int32 Cell = CellIndex(Positions[i]);
+            for (int32 Entry = CellStarts[Cell]; Entry < CellStarts[Cell + 1]; Entry++)
+            {
+                ChunkContacts += ColliderList[CellColliders[Entry]].ResolvePoint(Positions[i]) ? 1 : 0;
+            }
+        }
+
+        FPlatformAtomics::InterlockedAdd(&Contacts, ChunkContacts);
+    }, NumChunks == 1);
+
+    return Contacts;
+}
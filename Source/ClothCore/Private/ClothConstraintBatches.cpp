@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothConstraintBatches.h"
+#include "ClothConstraintStore.h"
+#include "ClothConstraintKernel.h"
+#include "Async/ParallelFor.h"
+
+void ClothConstraintBatches::Build(ClothConstraintStore& _constraints, int32 _numParticles)
+{
+    Batches.Reset();
+
+    const int32 NumConstraints = _constraints.Num();
+
+    // Colours 0-63 are structural, 64-127 interwoven
+    TArray<uint8> Colours;
+    Colours.SetNumUninitialized(NumConstraints);
+
+    TArray<int32> ColourCounts;
+    ColourCounts.SetNumZeroed(128);
+
+    for (int32 Pass = 0; Pass < 2; Pass++)
+    {
+        const bool Interwoven = Pass == 1;
+
+        // Bit N set means the particle already has a constraint of colour N
+        TArray<uint64> UsedColours;
+        UsedColours.SetNumZeroed(_numParticles);
+
+        for (int32 i = 0; i < NumConstraints; i++)
+        {
+            if (_constraints.GetInterwoven(i) != Interwoven)
+            {
+                continue;
+            }
+
+            const int32 A = _constraints.ParticleA[i];
+            const int32 B = _constraints.ParticleB[i];
+            const uint64 Used = UsedColours[A] | UsedColours[B];
+
+            // A regular grid needs 4 colours per constraint type, so 64 is plenty
+            const int32 Colour = FMath::CountTrailingZeros64(~Used);
+            check(Colour < 64);
+
+            UsedColours[A] |= 1ull << Colour;
+            UsedColours[B] |= 1ull << Colour;
+
+            Colours[i] = Colour + Pass * 64;
+            ColourCounts[Colours[i]]++;
+        }
+    }
+
+    // Counting sort by colour, keeping the original order inside a batch
+    TArray<int32> ColourStarts;
+    ColourStarts.SetNumUninitialized(128);
+
+    int32 Offset = 0;
+    for (int32 Colour = 0; Colour < 128; Colour++)
+    {
+        ColourStarts[Colour] = Offset;
+
+        if (ColourCounts[Colour] > 0)
+        {
+            Batch& NewBatch = Batches.AddDefaulted_GetRef();
+            NewBatch.First = Offset;
+            NewBatch.Count = ColourCounts[Colour];
+            NewBatch.IsInterwoven = Colour >= 64;
+        }
+        Offset += ColourCounts[Colour];
+    }
+
+    TArray<int32> NewOrder;
+    NewOrder.SetNumUninitialized(NumConstraints);
+    for (int32 i = 0; i < NumConstraints; i++)
+    {
+        NewOrder[ColourStarts[Colours[i]]++] = i;
+    }
+
+    _constraints.Reorder(NewOrder);
+}
+
+void ClothConstraintBatches::Empty()
+{
+    Batches.Empty();
+}
+
+int32 ClothConstraintBatches::Solve(ClothConstraintStore& _constraints, ClothParticleStore& _particles, float _deltaTime, bool _includeInterwoven)
+{
+    int32 NumSolved = 0;
+
+    for (const Batch& CurrentBatch : Batches)
+    {
+        if (CurrentBatch.IsInterwoven && !_includeInterwoven)
+        {
+            continue;
+        }
+
+        const int32 NumChunks = FMath::DivideAndRoundUp(CurrentBatch.Count, ChunkSize);
+        const int32 BatchChunkSize = ChunkSize;
+
+        // Constraints in a batch never share a particle so the chunks can run in any order
+        ParallelFor(NumChunks, [&, BatchChunkSize](int32 Chunk)
+        {
+            const int32 First = CurrentBatch.First + Chunk * BatchChunkSize;
+            const int32 Count = FMath::Min(BatchChunkSize, CurrentBatch.First + CurrentBatch.Count - First);
+
+            ClothConstraintKernel::SolveRange(_constraints, _particles, First, Count, _deltaTime);
+        }, NumChunks == 1);
+
+        NumSolved += CurrentBatch.Count;
+    }
+    return NumSolved;
+}
+
+ClothSolverResidual ClothConstraintBatches::SolveXPBD(ClothConstraintStore& _constraints, ClothParticleStore& _particles, float _alphaTilde, float _damageTime, bool _includeInterwoven)
+{
+    float MaxStrain = 0.0f;
+    double SumSquaredStrain = 0.0;
+    int32 NumSolved = 0;
+
+    for (const Batch& CurrentBatch : Batches)
+    {
+        if (CurrentBatch.IsInterwoven && !_includeInterwoven)
+        {
+            continue;
+        }
+
+        const int32 NumChunks = FMath::DivideAndRoundUp(CurrentBatch.Count, ChunkSize);
+        const int32 BatchChunkSize = ChunkSize;
+
+        ChunkMaxStrain.SetNumUninitialized(NumChunks, false);
+        ChunkSumSquaredStrain.SetNumUninitialized(NumChunks, false);
+        ChunkSolved.SetNumUninitialized(NumChunks, false);
+
+        ParallelFor(NumChunks, [&, BatchChunkSize](int32 Chunk)
+        {
+            const int32 First = CurrentBatch.First + Chunk * BatchChunkSize;
+            const int32 Last = FMath::Min(First + BatchChunkSize, CurrentBatch.First + CurrentBatch.Count);
+
+            float ChunkMax = 0.0f;
+            float ChunkSum = 0.0f;
+            for (int32 i = First; i < Last; i++)
+            {
+                const float Strain = _constraints.SolveConstraintXPBD(i, _particles, _alphaTilde, _damageTime);
+                ChunkMax = FMath::Max(ChunkMax, Strain);
+                ChunkSum += Strain * Strain;
+            }
+
+            ChunkMaxStrain[Chunk] = ChunkMax;
+            ChunkSumSquaredStrain[Chunk] = ChunkSum;
+            ChunkSolved[Chunk] = Last - First;
+        }, NumChunks == 1);
+
+        for (int32 Chunk = 0; Chunk < NumChunks; Chunk++)
+        {
+            MaxStrain = FMath::Max(MaxStrain, ChunkMaxStrain[Chunk]);
+            SumSquaredStrain += ChunkSumSquaredStrain[Chunk];
+            NumSolved += ChunkSolved[Chunk];
+        }
+    }
+
+    ClothSolverResidual Residual;
+    Residual.MaxStrain = MaxStrain;
+    Residual.RmsStrain = NumSolved > 0 ? (float)FMath::Sqrt(SumSquaredStrain / NumSolved) : 0.0f;
+    Residual.NumSolved = NumSolved;
+    return Residual;
+}
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothConstraintKernel.h"
+#include "ClothConstraintStore.h"
+#include "ClothParticleStore.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarClothVectorConstraints(
+    TEXT("cloth.VectorConstraints"),
+    true,
+    TEXT("Solve cloth distance constraints with the SIMD kernel (1) or the scalar reference (0)."));
+
+void ClothConstraintKernel::SolveRange(ClothConstraintStore& _constraints, ClothParticleStore& _particles,
+    int32 _first, int32 _count, float _deltaTime)
+{
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+    if (CVarClothVectorConstraints.GetValueOnAnyThread())
+    {
+        SolveRangeVector(_constraints, _particles, _first, _count, _deltaTime);
+        return;
+    }
+#endif
+    SolveRangeScalar(_constraints, _particles, _first, _count, _deltaTime);
+}
+
+void ClothConstraintKernel::SolveRangeScalar(ClothConstraintStore& _constraints, ClothParticleStore& _particles,
+    int32 _first, int32 _count, float _deltaTime)
+{
+    for (int32 i = _first; i < _first + _count; i++)
+    {
+        _constraints.SolveConstraint(i, _particles, _deltaTime);
+    }
+}
+
+void ClothConstraintKernel::SolveRangeVector(ClothConstraintStore& _constraints, ClothParticleStore& _particles,
+    int32 _first, int32 _count, float _deltaTime)
+{
+    const int32 End = _first + _count;
+    const int32 VectorEnd = _first + (_count / Width) * Width;
+
+    const VectorRegister4Float MaxStrain = VectorSetFloat1(_constraints.MaxStrain);
+    const VectorRegister4Float DamageStep = VectorSetFloat1(_constraints.DamageScale * _deltaTime);
+    const VectorRegister4Float Zero = VectorZeroFloat();
+    const VectorRegister4Float One = VectorOneFloat();
+
+    const int32* ParticleA = _constraints.ParticleA.GetData();
+    const int32* ParticleB = _constraints.ParticleB.GetData();
+    const float* RestLengths = _constraints.RestLengths.GetData();
+    float* Health = _constraints.Health.GetData();
+    const uint8* ConstraintFlags = _constraints.Flags.GetData();
+    FVector3f* Positions = _particles.Positions.GetData();
+    const float* InverseMasses = _particles.InverseMasses.GetData();
+
+    for (int32 i = _first; i < VectorEnd; i += Width)
+    {
+        // Gather the endpoints into lane order
+        alignas(16) float AX[Width], AY[Width], AZ[Width];
+        alignas(16) float BX[Width], BY[Width], BZ[Width];
+        alignas(16) float WA[Width], WB[Width];
+        alignas(16) float Active[Width];
+
+        for (int32 Lane = 0; Lane < Width; Lane++)
+        {
+            const FVector3f& PositionA = Positions[ParticleA[i + Lane]];
+            const FVector3f& PositionB = Positions[ParticleB[i + Lane]];
+            AX[Lane] = PositionA.X; AY[Lane] = PositionA.Y; AZ[Lane] = PositionA.Z;
+            BX[Lane] = PositionB.X; BY[Lane] = PositionB.Y; BZ[Lane] = PositionB.Z;
+            WA[Lane] = InverseMasses[ParticleA[i + Lane]];
+            WB[Lane] = InverseMasses[ParticleB[i + Lane]];
+            Active[Lane] = (ConstraintFlags[i + Lane] & EClothConstraintFlags::Enabled) ? 1.0f : 0.0f;
+        }
+
+        const VectorRegister4Float InvMassA = VectorLoadAligned(WA);
+        const VectorRegister4Float InvMassB = VectorLoadAligned(WB);
+        const VectorRegister4Float InvMassSum = VectorAdd(InvMassA, InvMassB);
+
+        // Disabled constraints and constraints between two pinned particles do nothing
+        const VectorRegister4Float ActiveMask = VectorBitwiseAnd(
+            VectorCompareGT(VectorLoadAligned(Active), Zero),
+            VectorCompareGT(InvMassSum, Zero));
+
+        if (VectorMaskBits(ActiveMask) == 0)
+        {
+            continue;
+        }
+
+        const VectorRegister4Float DX = VectorSubtract(VectorLoadAligned(BX), VectorLoadAligned(AX));
+        const VectorRegister4Float DY = VectorSubtract(VectorLoadAligned(BY), VectorLoadAligned(AY));
+        const VectorRegister4Float DZ = VectorSubtract(VectorLoadAligned(BZ), VectorLoadAligned(AZ));
+
+        // Same operation order as FVector3f::Size so the lanes match the scalar path
+        const VectorRegister4Float DistanceSquared = VectorAdd(VectorAdd(VectorMultiply(DX, DX), VectorMultiply(DY, DY)), VectorMultiply(DZ, DZ));
+        const VectorRegister4Float Distance = VectorSqrt(DistanceSquared);
+        const VectorRegister4Float Rest = VectorLoad(RestLengths + i);
+
+        // Strain damage, only for lanes that are actually solved
+        const VectorRegister4Float Strain = VectorDivide(VectorSubtract(Distance, Rest), Rest);
+        const VectorRegister4Float ExcessStrain = VectorSelect(
+            VectorBitwiseAnd(ActiveMask, VectorCompareGT(Strain, MaxStrain)),
+            VectorSubtract(Strain, MaxStrain), Zero);
+        const VectorRegister4Float NewHealth = VectorSubtract(VectorLoad(Health + i), VectorMultiply(ExcessStrain, DamageStep));
+        VectorStore(NewHealth, Health + i);
+
+        const VectorRegister4Float BrokenMask = VectorBitwiseAnd(ActiveMask, VectorCompareLE(NewHealth, Zero));
+        const int32 SolveBits = VectorMaskBits(ActiveMask) & ~VectorMaskBits(BrokenMask);
+
+        // Share the correction by inverse mass, which gives half each or all to the free end
+        const VectorRegister4Float Scale = VectorSubtract(One, VectorDivide(Rest, Distance));
+        const VectorRegister4Float ShareA = VectorDivide(InvMassA, VectorSelect(ActiveMask, InvMassSum, One));
+        const VectorRegister4Float ShareB = VectorDivide(InvMassB, VectorSelect(ActiveMask, InvMassSum, One));
+
+        alignas(16) float CX[Width], CY[Width], CZ[Width];
+        alignas(16) float SA[Width], SB[Width];
+        VectorStoreAligned(VectorMultiply(DX, Scale), CX);
+        VectorStoreAligned(VectorMultiply(DY, Scale), CY);
+        VectorStoreAligned(VectorMultiply(DZ, Scale), CZ);
+        VectorStoreAligned(ShareA, SA);
+        VectorStoreAligned(ShareB, SB);
+
+        // Scatter, no two lanes touch the same particle
+        for (int32 Lane = 0; Lane < Width; Lane++)
+        {
+            if (SolveBits & (1 << Lane))
+            {
+                const FVector3f Correction(CX[Lane], CY[Lane], CZ[Lane]);
+                // Pinned ends are skipped rather than offset by zero
+                if (SA[Lane] > 0.0f)
+                {
+                    Positions[ParticleA[i + Lane]] += Correction * SA[Lane];
+                }
+                if (SB[Lane] > 0.0f)
+                {
+                    Positions[ParticleB[i + Lane]] -= Correction * SB[Lane];
+                }
+            }
+        }
+
+        const int32 BrokenBits = VectorMaskBits(BrokenMask);
+        if (BrokenBits != 0)
+        {
+            for (int32 Lane = 0; Lane < Width; Lane++)
+            {
+                if (BrokenBits & (1 << Lane))
+                {
+                    _constraints.DisableConstraint(i + Lane);
+                }
+            }
+        }
+    }
+
+    // Remainder that does not fill a vector
+    SolveRangeScalar(_constraints, _particles, VectorEnd, End - VectorEnd, _deltaTime);
+}
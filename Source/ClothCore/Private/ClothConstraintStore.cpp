@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothConstraintStore.h"
+#include "ClothParticleStore.h"
+#include "ClothArena.h"
+
+SIZE_T ClothConstraintStore::ArenaSize(int32 _maxConstraints, int32 _numParticles)
+{
+    return ClothArena::SizeFor<int32>(_maxConstraints) * 3 +
+        ClothArena::SizeFor<float>(_maxConstraints) * 3 +
+        ClothArena::SizeFor<uint8>(_maxConstraints) * 2 +
+        ClothArena::SizeFor<uint8>(_numParticles) +
+        ClothArena::SizeFor<int32>(_numParticles * EClothLinks::Num);
+}
+
+void ClothConstraintStore::Initialise(ClothArena& _arena, int32 _maxConstraints, int32 _numParticles)
+{
+    ParticleA = _arena.Allocate<int32>(_maxConstraints);
+    ParticleB = _arena.Allocate<int32>(_maxConstraints);
+    BrokenConstraints = _arena.Allocate<int32>(_maxConstraints);
+    RestLengths = _arena.Allocate<float>(_maxConstraints);
+    Health = _arena.Allocate<float>(_maxConstraints);
+    Lambdas = _arena.Allocate<float>(_maxConstraints);
+    Flags = _arena.Allocate<uint8>(_maxConstraints);
+    Links = _arena.Allocate<uint8>(_maxConstraints);
+    ParticleLinks = _arena.Allocate<uint8>(_numParticles);
+    LinkConstraints = _arena.Allocate<int32>(_numParticles * EClothLinks::Num);
+
+    NumConstraints = 0;
+    NumBroken = 0;
+}
+
+int32 ClothConstraintStore::Add(const ClothParticleStore& _particles, int32 _particleA, int32 _particleB, EClothLinks::Type _link)
+{
+    check(NumConstraints < ParticleA.Num());
+
+    const int32 Index = NumConstraints++;
+
+    ParticleA[Index] = _particleA;
+    ParticleB[Index] = _particleB;
+    RestLengths[Index] = FVector3f::Dist(_particles.Positions[_particleB], _particles.Positions[_particleA]);
+    Health[Index] = InitialHealth;
+    Lambdas[Index] = 0.0f;
+
+    Links[Index] = _link;
+
+    uint8 NewFlags = EClothConstraintFlags::Enabled;
+    if (_link == EClothLinks::RightInterwoven || _link == EClothLinks::DownInterwoven)
+    {
+        NewFlags |= EClothConstraintFlags::Interwoven;
+    }
+    Flags[Index] = NewFlags;
+
+    return Index;
+}
+
+void ClothConstraintStore::Empty()
+{
+    ParticleA = {};
+    ParticleB = {};
+    RestLengths = {};
+    Health = {};
+    Flags = {};
+    Links = {};
+    Lambdas = {};
+    ParticleLinks = {};
+    LinkConstraints = {};
+    BrokenConstraints = {};
+    NumConstraints = 0;
+    NumBroken = 0;
+
+    NumHorz = 0;
+}
+
+void ClothConstraintStore::OnStateRestored()
+{
+    NumBroken = 0;
+
+    // Everything built from the links has to be rebuilt
+    FPlatformAtomics::InterlockedIncrement(&TopologyVersion);
+}
+
+void ClothConstraintStore::DisableConstraint(int32 _index)
+{
+    if (!GetEnabled(_index))
+    {
+        return;
+    }
+
+    // Only ParticleA owns the link, so constraints in one batch never write the same byte
+    ParticleLinks[ParticleA[_index]] &= ~Links[_index];
+
+    Flags[_index] &= ~EClothConstraintFlags::Enabled;
+
+    // Constraints can break on worker threads during the parallel solve
+    const int32 Slot = FPlatformAtomics::InterlockedIncrement(&NumBroken) - 1;
+    BrokenConstraints[Slot] = _index;
+    FPlatformAtomics::InterlockedIncrement(&TopologyVersion);
+}
+
+void ClothConstraintStore::TakeDamage(int32 _index, float _damage)
+{
+    Health[_index] -= _damage;
+}
+
+void ClothConstraintStore::SolveConstraint(int32 _index, ClothParticleStore& _particles, float _deltaTime)
+{
+    if (!GetEnabled(_index))
+    {
+        return;
+    }
+
+    // Sleeping particles are held like pins
+    const bool MoveA = _particles.IsMovable(ParticleA[_index]);
+    const bool MoveB = _particles.IsMovable(ParticleB[_index]);
+
+    if (MoveA && MoveB)
+    {
+        SolveActiveConstraint<true, true>(_index, _particles, _deltaTime);
+    }
+    else if (MoveA)
+    {
+        SolveActiveConstraint<true, false>(_index, _particles, _deltaTime);
+    }
+    else if (MoveB)
+    {
+        SolveActiveConstraint<false, true>(_index, _particles, _deltaTime);
+    }
+}
+
+void ClothConstraintStore::ResetLambdas()
+{
+    FMemory::Memzero(Lambdas.GetData(), Lambdas.Num() * sizeof(float));
+}
+
+float ClothConstraintStore::SolveConstraintXPBD(int32 _index, ClothParticleStore& _particles, float _alphaTilde, float _damageTime)
+{
+    if (!GetEnabled(_index))
+    {
+        return 0.0f;
+    }
+
+    const int32 A = ParticleA[_index];
+    const int32 B = ParticleB[_index];
+    const float InverseMassA = _particles.InverseMasses[A];
+    const float InverseMassB = _particles.InverseMasses[B];
+    const float InverseMassSum = InverseMassA + InverseMassB;
+
+    FVector3f CurrentOffset = _particles.Positions[B] - _particles.Positions[A];
+    float CurrentDistance = CurrentOffset.Size();
+
+    if (InverseMassSum <= 0.0f || CurrentDistance <= UE_SMALL_NUMBER)
+    {
+        return 0.0f;
+    }
+
+    const float RestDistance = RestLengths[_index];
+    const float Stretch = CurrentDistance - RestDistance;
+
+    // Same damage model as the reference solver, applied once per step rather than per iteration
+    float Strain = Stretch / RestDistance;
+    if (Strain > MaxStrain)
+    {
+        Health[_index] -= (Strain - MaxStrain) * DamageScale * _damageTime;
+    }
+    if (Health[_index] <= 0.0f)
+    {
+        DisableConstraint(_index);
+        return 0.0f;
+    }
+
+    // C(x) + alpha * lambda goes to zero as the iterations converge, whatever the compliance
+    const float Residual = Stretch + _alphaTilde * Lambdas[_index];
+    const float DeltaLambda = -Residual / (InverseMassSum + _alphaTilde);
+    Lambdas[_index] += DeltaLambda;
+
+    const FVector3f Direction = CurrentOffset / CurrentDistance;
+    _particles.Positions[A] -= Direction * (InverseMassA * DeltaLambda);
+    _particles.Positions[B] += Direction * (InverseMassB * DeltaLambda);
+
+    return FMath::Abs(Residual) / RestDistance;
+}
+
+namespace
+{
+    template<typename T>
+    void ReorderArray(TArrayView<T> _array, const TArray<int32>& _newOrder)
+    {
+        TArray<T> Reordered;
+        Reordered.SetNumUninitialized(_newOrder.Num());
+        for (int32 i = 0; i < _newOrder.Num(); i++)
+        {
+            Reordered[i] = _array[_newOrder[i]];
+        }
+        FMemory::Memcpy(_array.GetData(), Reordered.GetData(), Reordered.Num() * sizeof(T));
+    }
+}
+
+void ClothConstraintStore::Reorder(const TArray<int32>& _newOrder)
+{
+    check(_newOrder.Num() == Num());
+
+    ReorderArray(ParticleA, _newOrder);
+    ReorderArray(ParticleB, _newOrder);
+    ReorderArray(RestLengths, _newOrder);
+    ReorderArray(Health, _newOrder);
+    ReorderArray(Flags, _newOrder);
+    ReorderArray(Links, _newOrder);
+    ReorderArray(Lambdas, _newOrder);
+}
+
+void ClothConstraintStore::BuildParticleLinks(int32 _numHorz, int32 _numVert)
+{
+    NumHorz = _numHorz;
+
+    check(ParticleLinks.Num() == _numHorz * _numVert);
+
+    FMemory::Memzero(ParticleLinks.GetData(), ParticleLinks.Num());
+    for (int32& LinkConstraint : LinkConstraints)
+    {
+        LinkConstraint = INDEX_NONE;
+    }
+    NumBroken = 0;
+
+    for (int32 i = 0; i < Num(); i++)
+    {
+        const int32 Owner = ParticleA[i];
+        LinkConstraints[Owner * EClothLinks::Num + FMath::CountTrailingZeros(Links[i])] = i;
+
+        if (GetEnabled(i))
+        {
+            ParticleLinks[Owner] |= Links[i];
+        }
+    }
+}
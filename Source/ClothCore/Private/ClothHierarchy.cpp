@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothHierarchy.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "Async/ParallelFor.h"
+
+void ClothHierarchy::Build(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints, int32 _maxLevels)
+{
+    Levels.Reset();
+
+    FineNumHorz = _particles.GetNumHorz();
+    FineNumVert = _particles.GetNumVert();
+
+    // Halve the resolution until a level would be smaller than 3x3
+    for (int32 Stride = 2; Levels.Num() < _maxLevels; Stride *= 2)
+    {
+        const int32 NumHorz = (FineNumHorz - 1) / Stride + 1;
+        const int32 NumVert = (FineNumVert - 1) / Stride + 1;
+        if (NumHorz < 3 || NumVert < 3)
+        {
+            break;
+        }
+
+        Level& NewLevel = Levels.AddDefaulted_GetRef();
+        NewLevel.Stride = Stride;
+        NewLevel.NumHorz = NumHorz;
+        NewLevel.NumVert = NumVert;
+        BuildLevel(NewLevel, _particles);
+    }
+
+    TopologyVersion = INDEX_NONE;
+    UpdateLinks(_constraints);
+}
+
+void ClothHierarchy::BuildLevel(Level& _level, const ClothParticleStore& _particles)
+{
+    const int32 NumNodes = _level.NumHorz * _level.NumVert;
+
+    _level.FineIndices.SetNumUninitialized(NumNodes);
+    for (int32 Vert = 0; Vert < _level.NumVert; Vert++)
+    {
+        for (int32 Horz = 0; Horz < _level.NumHorz; Horz++)
+        {
+            _level.FineIndices[Horz + Vert * _level.NumHorz] = _particles.GetIndex(Horz * _level.Stride, Vert * _level.Stride);
+        }
+    }
+
+    _level.Positions.SetNumZeroed(NumNodes);
+    _level.StartPositions.SetNumZeroed(NumNodes);
+    _level.InverseMasses.SetNumZeroed(NumNodes);
+
+    _level.ParticleA.Reset();
+    _level.ParticleB.Reset();
+    _level.RestLengths.Reset();
+
+    auto AddConstraint = [&](int32 _a, int32 _b)
+    {
+        _level.ParticleA.Add(_a);
+        _level.ParticleB.Add(_b);
+        _level.RestLengths.Add(FVector3f::Dist(_particles.Positions[_level.FineIndices[_a]], _particles.Positions[_level.FineIndices[_b]]));
+    };
+
+    // Even then odd columns of right constraints, then even then odd rows of down constraints.
+    // No two constraints in one batch share a node
+    int32 Batch = 0;
+    for (int32 Parity = 0; Parity < 2; Parity++)
+    {
+        _level.BatchStarts[Batch++] = _level.ParticleA.Num();
+        for (int32 Vert = 0; Vert < _level.NumVert; Vert++)
+        {
+            for (int32 Horz = Parity; Horz < _level.NumHorz - 1; Horz += 2)
+            {
+                const int32 Node = Horz + Vert * _level.NumHorz;
+                AddConstraint(Node, Node + 1);
+            }
+        }
+    }
+    for (int32 Parity = 0; Parity < 2; Parity++)
+    {
+        _level.BatchStarts[Batch++] = _level.ParticleA.Num();
+        for (int32 Vert = Parity; Vert < _level.NumVert - 1; Vert += 2)
+        {
+            for (int32 Horz = 0; Horz < _level.NumHorz; Horz++)
+            {
+                const int32 Node = Horz + Vert * _level.NumHorz;
+                AddConstraint(Node, Node + _level.NumHorz);
+            }
+        }
+    }
+    _level.BatchStarts[Batch] = _level.ParticleA.Num();
+
+    _level.Enabled.Init(1, _level.ParticleA.Num());
+}
+
+void ClothHierarchy::Empty()
+{
+    Levels.Empty();
+    FineNumHorz = 0;
+    FineNumVert = 0;
+    TopologyVersion = INDEX_NONE;
+}
+
+void ClothHierarchy::UpdateLinks(const ClothConstraintStore& _constraints)
+{
+    if (TopologyVersion == _constraints.GetTopologyVersion())
+    {
+        return;
+    }
+
+    for (Level& CurrentLevel : Levels)
+    {
+        RefreshLinks(CurrentLevel, _constraints);
+    }
+
+    TopologyVersion = _constraints.GetTopologyVersion();
+}
+
+void ClothHierarchy::RefreshLinks(Level& _level, const ClothConstraintStore& _constraints) const
+{
+    for (int32 i = 0; i < _level.ParticleA.Num(); i++)
+    {
+        const int32 FineA = _level.FineIndices[_level.ParticleA[i]];
+        const int32 FineB = _level.FineIndices[_level.ParticleB[i]];
+
+        // Walk the fine links the coarse constraint spans, it only holds if all of them do
+        const bool IsRight = FineB - FineA < FineNumHorz;
+        const EClothLinks::Type Link = IsRight ? EClothLinks::Right : EClothLinks::Down;
+        const int32 Step = IsRight ? 1 : FineNumHorz;
+
+        bool Intact = true;
+        for (int32 Fine = FineA; Fine < FineB && Intact; Fine += Step)
+        {
+            Intact = _constraints.HasLink(Fine, Link);
+        }
+
+        _level.Enabled[i] = Intact ? 1 : 0;
+    }
+}
+
+void ClothHierarchy::Solve(ClothParticleStore& _particles, int32 _iterations)
+{
+    // Coarsest first, each level starts from the fine positions the coarser levels already corrected
+    for (int32 LevelIndex = Levels.Num() - 1; LevelIndex >= 0; LevelIndex--)
+    {
+        Level& CurrentLevel = Levels[LevelIndex];
+
+        // Restrict by injection
+        for (int32 Node = 0; Node < CurrentLevel.FineIndices.Num(); Node++)
+        {
+            const int32 Fine = CurrentLevel.FineIndices[Node];
+            CurrentLevel.Positions[Node] = _particles.Positions[Fine];
+            CurrentLevel.InverseMasses[Node] = _particles.InverseMasses[Fine];
+        }
+        CurrentLevel.StartPositions = CurrentLevel.Positions;
+
+        SolveLevel(CurrentLevel, _iterations);
+        Prolongate(CurrentLevel, _particles);
+    }
+}
+
+void ClothHierarchy::SolveLevel(Level& _level, int32 _iterations) const
+{
+    for (int32 Iteration = 0; Iteration < _iterations; Iteration++)
+    {
+        for (int32 Batch = 0; Batch < 4; Batch++)
+        {
+            const int32 BatchFirst = _level.BatchStarts[Batch];
+            const int32 BatchEnd = _level.BatchStarts[Batch + 1];
+            const int32 NumChunks = FMath::DivideAndRoundUp(BatchEnd - BatchFirst, ChunkSize);
+
+            ParallelFor(NumChunks, [&](int32 Chunk)
+            {
+                const int32 First = BatchFirst + Chunk * ChunkSize;
+                const int32 Last = FMath::Min(First + ChunkSize, BatchEnd);
+
+                for (int32 i = First; i < Last; i++)
+                {
+                    if (!_level.Enabled[i])
+                    {
+                        continue;
+                    }
+
+                    const int32 A = _level.ParticleA[i];
+                    const int32 B = _level.ParticleB[i];
+                    const float InverseMassA = _level.InverseMasses[A];
+                    const float InverseMassB = _level.InverseMasses[B];
+                    const float InverseMassSum = InverseMassA + InverseMassB;
+
+                    const FVector3f Offset = _level.Positions[B] - _level.Positions[A];
+                    const float Distance = Offset.Size();
+
+                    // Stretch only, a coarse span may shorten when the fine cloth between its nodes folds
+                    if (InverseMassSum <= 0.0f || Distance <= _level.RestLengths[i])
+                    {
+                        continue;
+                    }
+
+                    const FVector3f Correction = Offset * ((1.0f - _level.RestLengths[i] / Distance) / InverseMassSum);
+                    _level.Positions[A] += Correction * InverseMassA;
+                    _level.Positions[B] -= Correction * InverseMassB;
+                }
+            }, NumChunks == 1);
+        }
+    }
+}
+
+void ClothHierarchy::Prolongate(const Level& _level, ClothParticleStore& _particles) const
+{
+    const int32 Stride = _level.Stride;
+    const float InvStride = 1.0f / Stride;
+
+    // Bilinear interpolation of the coarse corrections, fine particles past the last coarse row or column copy its edge
+    ParallelFor(FineNumVert, [&](int32 Vert)
+    {
+        const int32 CoarseVert = FMath::Min(Vert / Stride, _level.NumVert - 1);
+        const int32 NextVert = FMath::Min(CoarseVert + 1, _level.NumVert - 1);
+        const float AlphaVert = NextVert != CoarseVert ? (Vert - CoarseVert * Stride) * InvStride : 0.0f;
+
+        for (int32 Horz = 0; Horz < FineNumHorz; Horz++)
+        {
+            const int32 Fine = _particles.GetIndex(Horz, Vert);
+            if (!_particles.IsMovable(Fine))
+            {
+                continue;
+            }
+
+            const int32 CoarseHorz = FMath::Min(Horz / Stride, _level.NumHorz - 1);
+            const int32 NextHorz = FMath::Min(CoarseHorz + 1, _level.NumHorz - 1);
+            const float AlphaHorz = NextHorz != CoarseHorz ? (Horz - CoarseHorz * Stride) * InvStride : 0.0f;
+
+            auto Delta = [&](int32 _horz, int32 _vert)
+            {
+                const int32 Node = _horz + _vert * _level.NumHorz;
+                return _level.Positions[Node] - _level.StartPositions[Node];
+            };
+
+            const FVector3f Top = FMath::Lerp(Delta(CoarseHorz, CoarseVert), Delta(NextHorz, CoarseVert), AlphaHorz);
+            const FVector3f Bottom = FMath::Lerp(Delta(CoarseHorz, NextVert), Delta(NextHorz, NextVert), AlphaHorz);
+            _particles.Positions[Fine] += FMath::Lerp(Top, Bottom, AlphaVert);
+        }
+    });
+}
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothParticleStore.h"
+#include "ClothArena.h"
+
+SIZE_T ClothParticleStore::ArenaSize(int32 _numParticles)
+{
+    return ClothArena::SizeFor<FVector3f>(_numParticles) * 3 +
+        ClothArena::SizeFor<float>(_numParticles) * 3 +
+        ClothArena::SizeFor<uint8>(_numParticles);
+}
+
+void ClothParticleStore::Initialise(ClothArena& _arena, int32 _numHorz, int32 _numVert)
+{
+    NumHorz = _numHorz;
+    NumVert = _numVert;
+
+    const int32 Count = NumHorz * NumVert;
+
+    // The arena hands out zeroed memory
+    Positions = _arena.Allocate<FVector3f>(Count);
+    PreviousPositions = _arena.Allocate<FVector3f>(Count);
+    Accelerations = _arena.Allocate<FVector3f>(Count);
+    InverseMasses = _arena.Allocate<float>(Count);
+    Damping = _arena.Allocate<float>(Count);
+    BurnAmounts = _arena.Allocate<float>(Count);
+    Flags = _arena.Allocate<uint8>(Count);
+
+    for (int32 i = 0; i < Count; i++)
+    {
+        InverseMasses[i] = 1.0f;
+        Damping[i] = DefaultDamping;
+    }
+}
+
+void ClothParticleStore::Empty()
+{
+    Positions = {};
+    PreviousPositions = {};
+    Accelerations = {};
+    InverseMasses = {};
+    Damping = {};
+    BurnAmounts = {};
+    Flags = {};
+
+    NumHorz = 0;
+    NumVert = 0;
+}
+
+void ClothParticleStore::SetInitialPosition(int32 _index, const FVector3f& _position)
+{
+    Positions[_index] = _position;
+    PreviousPositions[_index] = _position;
+}
+
+void ClothParticleStore::SetPinned(int32 _index, bool _isPinned)
+{
+    if (_isPinned)
+    {
+        Flags[_index] |= EClothParticleFlags::Pinned;
+    }
+    else
+    {
+        Flags[_index] &= ~EClothParticleFlags::Pinned;
+    }
+    InverseMasses[_index] = IsMovable(_index) ? 1.0f : 0.0f;
+    MobilityVersion++;
+}
+
+void ClothParticleStore::SetSleeping(int32 _index, bool _isSleeping)
+{
+    if (_isSleeping)
+    {
+        Flags[_index] |= EClothParticleFlags::Sleeping;
+    }
+    else
+    {
+        Flags[_index] &= ~EClothParticleFlags::Sleeping;
+    }
+    InverseMasses[_index] = IsMovable(_index) ? 1.0f : 0.0f;
+    MobilityVersion++;
+
+    // Wakes at rest, whatever was left in the Verlet velocity was below the sleep threshold
+    PreviousPositions[_index] = Positions[_index];
+    Accelerations[_index] = FVector3f::ZeroVector;
+}
+
+void ClothParticleStore::AddForce(int32 _index, const FVector3f& _force)
+{
+    // Do Nothing If Particle Is Pinned or asleep
+    if (!IsMovable(_index))
+    {
+        return;
+    }
+
+    Accelerations[_index] += _force;
+}
+
+void ClothParticleStore::AddBurn(int32 _index, float _burnAmount)
+{
+    BurnAmounts[_index] = FMath::Clamp(BurnAmounts[_index] + _burnAmount, 0.0f, 1.0f);
+}
+
+int32 ClothParticleStore::Integrate(float _deltaTime)
+{
+    const int32 Count = Num();
+    int32 NumIntegrated = 0;
+
+    // Non-Framerate independant verlet integration
+    for (int32 i = 0; i < Count; i++)
+    {
+        if (Flags[i] & (EClothParticleFlags::Pinned | EClothParticleFlags::Sleeping))
+        {
+            continue;
+        }
+
+        const FVector3f CachePosition = Positions[i];
+
+        Positions[i] += (CachePosition - PreviousPositions[i]) * (1.0f - Damping[i]) +
+            Accelerations[i] * _deltaTime;
+
+        Accelerations[i] = FVector3f::ZeroVector;
+        PreviousPositions[i] = CachePosition;
+        NumIntegrated++;
+    }
+    return NumIntegrated;
+}
+
+void ClothParticleStore::CheckForGroundCollision(float _groundHeight, bool _skipSleeping)
+{
+    if (_skipSleeping)
+    {
+        CheckForGroundCollision<true>(_groundHeight);
+    }
+    else
+    {
+        CheckForGroundCollision<false>(_groundHeight);
+    }
+}
+
+template<bool bSkipSleeping>
+void ClothParticleStore::CheckForGroundCollision(float _groundHeight)
+{
+    const int32 Count = Num();
+
+    for (int32 i = 0; i < Count; i++)
+    {
+        // Sleeping particles keep the contact they fell asleep with
+        if (bSkipSleeping && (Flags[i] & EClothParticleFlags::Sleeping))
+        {
+            continue;
+        }
+
+        if (Positions[i].Z <= _groundHeight)
+        {
+            Positions[i].Z = _groundHeight;
+            if (Accelerations[i].Z <= 0.0f)
+            {
+                Accelerations[i].Z = 0.0f;
+            }
+            Damping[i] = GroundDamping;
+            Flags[i] |= EClothParticleFlags::OnGround;
+        }
+        else
+        {
+            Flags[i] &= ~EClothParticleFlags::OnGround;
+        }
+    }
+}
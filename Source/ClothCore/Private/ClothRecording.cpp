@@ -0,0 +1,443 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothRecording.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Math/Float16.h"
+#include "Misc/FileHelper.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogClothRecording, Log, All);
+
+using namespace ClothRecordingFormat;
+
+namespace
+{
+    constexpr float QuantizeScale = 65535.0f;
+
+    int32 GetPositionsSize(int32 _numParticles)
+    {
+        return _numParticles * 3 * sizeof(uint16);
+    }
+
+    // Burn bytes are padded so the constraint deltas stay 4 byte aligned
+    int32 GetBurnSize(int32 _numParticles)
+    {
+        return Align(_numParticles, 4);
+    }
+
+    uint16 QuantizeAxis(float _value, float _min, float _invSize)
+    {
+        return (uint16)FMath::Clamp(FMath::RoundToInt((_value - _min) * _invSize * QuantizeScale), 0, 65535);
+    }
+
+    uint16 EncodeHealth(float _health)
+    {
+        FFloat16 Half(_health);
+        return Half.Encoded;
+    }
+
+    float DecodeHealth(uint16 _bits)
+    {
+        FFloat16 Half;
+        Half.Encoded = _bits;
+        return Half.GetFloat();
+    }
+
+    void DecodePositionsInto(const uint8* _frame, const FFrameHeader& _frameHeader, TArrayView<FVector3f> _outPositions)
+    {
+        const uint8* Quantized = _frame + sizeof(FFrameHeader);
+        const FVector3f Scale = _frameHeader.BoundsSize / QuantizeScale;
+
+        for (int32 i = 0; i < _outPositions.Num(); i++)
+        {
+            uint16 Axes[3];
+            FMemory::Memcpy(Axes, Quantized + i * sizeof(Axes), sizeof(Axes));
+            _outPositions[i] = _frameHeader.BoundsMin + FVector3f(Axes[0], Axes[1], Axes[2]) * Scale;
+        }
+    }
+}
+
+ClothRecordingWriter::~ClothRecordingWriter()
+{
+    Close();
+}
+
+bool ClothRecordingWriter::Open(const FString& _path, int32 _numHorz, int32 _numVert, int32 _numConstraints, float _timeStep)
+{
+    Close();
+
+    Archive.Reset(IFileManager::Get().CreateFileWriter(*_path));
+    if (!Archive.IsValid())
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("Could not open %s for recording"), *_path);
+        return false;
+    }
+
+    FHeader Header;
+    Header.Magic = ClothRecordingFormat::Magic;
+    Header.Version = ClothRecordingFormat::Version;
+    Header.HeaderSize = sizeof(FHeader);
+    Header.NumHorz = _numHorz;
+    Header.NumVert = _numVert;
+    Header.NumConstraints = _numConstraints;
+    Header.TimeStep = _timeStep;
+
+    // Nothing is in the pipe yet, so the header can go straight out
+    Archive->Serialize(&Header, sizeof(Header));
+    WriteOffset = sizeof(Header);
+
+    FrameOffsets.Reset();
+    LastHealth.Reset();
+    LastEnabled.Reset();
+    return true;
+}
+
+void ClothRecordingWriter::Close()
+{
+    if (!Archive.IsValid())
+    {
+        return;
+    }
+
+    if (LastWrite.IsValid())
+    {
+        LastWrite.Wait();
+        LastWrite = {};
+    }
+
+    FFooter Footer;
+    Footer.FrameTableOffset = WriteOffset;
+    Footer.NumFrames = FrameOffsets.Num();
+    Footer.Magic = ClothRecordingFormat::Magic;
+
+    Archive->Serialize(FrameOffsets.GetData(), FrameOffsets.Num() * sizeof(uint64));
+    Archive->Serialize(&Footer, sizeof(Footer));
+    Archive->Close();
+    Archive.Reset();
+
+    UE_LOG(LogClothRecording, Log, TEXT("Recorded %d frames, %llu bytes"), FrameOffsets.Num(), WriteOffset + Footer.NumFrames * sizeof(uint64) + sizeof(Footer));
+}
+
+void ClothRecordingWriter::WriteFrame(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints)
+{
+    check(Archive.IsValid());
+
+    const int32 NumParticles = _particles.Num();
+    const int32 NumConstraints = _constraints.Num();
+
+    // The first frame deltas against the freshly built cloth
+    if (LastHealth.Num() != NumConstraints)
+    {
+        LastHealth.Init(EncodeHealth(_constraints.GetInitialHealth()), NumConstraints);
+        LastEnabled.Init(1, NumConstraints);
+    }
+
+    FFrameHeader FrameHeader;
+
+    FBox3f Bounds(ForceInit);
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        Bounds += _particles.Positions[i];
+    }
+    FrameHeader.BoundsMin = Bounds.Min;
+    FrameHeader.BoundsSize = Bounds.GetSize();
+
+    const int32 PositionsOffset = sizeof(FFrameHeader);
+    const int32 BurnOffset = PositionsOffset + GetPositionsSize(NumParticles);
+    const int32 DeltasOffset = BurnOffset + GetBurnSize(NumParticles);
+
+    // Encoded here so the stores can keep changing while the bytes are written
+    TArray<uint8> Frame;
+    Frame.SetNumZeroed(DeltasOffset);
+
+    const FVector3f InvSize(
+        1.0f / FMath::Max(FrameHeader.BoundsSize.X, UE_SMALL_NUMBER),
+        1.0f / FMath::Max(FrameHeader.BoundsSize.Y, UE_SMALL_NUMBER),
+        1.0f / FMath::Max(FrameHeader.BoundsSize.Z, UE_SMALL_NUMBER));
+
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        const FVector3f& Position = _particles.Positions[i];
+        const uint16 Axes[3] =
+        {
+            QuantizeAxis(Position.X, FrameHeader.BoundsMin.X, InvSize.X),
+            QuantizeAxis(Position.Y, FrameHeader.BoundsMin.Y, InvSize.Y),
+            QuantizeAxis(Position.Z, FrameHeader.BoundsMin.Z, InvSize.Z),
+        };
+        FMemory::Memcpy(&Frame[PositionsOffset + i * sizeof(Axes)], Axes, sizeof(Axes));
+
+        Frame[BurnOffset + i] = (uint8)FMath::RoundToInt(FMath::Clamp(_particles.BurnAmounts[i], 0.0f, 1.0f) * 255.0f);
+    }
+
+    // Only the constraints that changed since the last frame, most frames have few or none
+    for (int32 i = 0; i < NumConstraints; i++)
+    {
+        const uint16 Health = EncodeHealth(_constraints.Health[i]);
+        const uint8 Enabled = _constraints.GetEnabled(i) ? 1 : 0;
+
+        if (Health == LastHealth[i] && Enabled == LastEnabled[i])
+        {
+            continue;
+        }
+
+        LastHealth[i] = Health;
+        LastEnabled[i] = Enabled;
+
+        FConstraintDelta Delta;
+        Delta.Index = i;
+        Delta.Health = Health;
+        Delta.Enabled = Enabled;
+        Frame.Append((const uint8*)&Delta, sizeof(Delta));
+        FrameHeader.NumConstraintDeltas++;
+    }
+
+    FrameHeader.FrameSize = Frame.Num();
+    FMemory::Memcpy(Frame.GetData(), &FrameHeader, sizeof(FrameHeader));
+
+    FrameOffsets.Add(WriteOffset);
+    WriteOffset += Frame.Num();
+
+    // The pipe keeps the writes in order without holding a worker between frames
+    LastWrite = WritePipe.Launch(UE_SOURCE_LOCATION, [Output = Archive.Get(), Frame = MoveTemp(Frame)]() mutable
+    {
+        Output->Serialize(Frame.GetData(), Frame.Num());
+    });
+}
+
+ClothRecordingReader::ClothRecordingReader() = default;
+
+ClothRecordingReader::~ClothRecordingReader()
+{
+    Close();
+}
+
+bool ClothRecordingReader::Open(const FString& _path)
+{
+    Close();
+
+    MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*_path));
+    if (MappedFile.IsValid())
+    {
+        MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+    }
+
+    if (MappedRegion.IsValid())
+    {
+        Data = MappedRegion->GetMappedPtr();
+        Size = MappedRegion->GetMappedSize();
+    }
+    else if (FFileHelper::LoadFileToArray(FileData, *_path, FILEREAD_Silent))
+    {
+        Data = FileData.GetData();
+        Size = FileData.Num();
+    }
+    else
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("Could not open recording %s"), *_path);
+        Close();
+        return false;
+    }
+
+    FFooter Footer;
+    if (Size < (int64)(sizeof(FHeader) + sizeof(FFooter)))
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("%s is too small to be a cloth recording"), *_path);
+        Close();
+        return false;
+    }
+
+    FMemory::Memcpy(&Header, Data, sizeof(Header));
+    FMemory::Memcpy(&Footer, Data + Size - sizeof(Footer), sizeof(Footer));
+
+    if (Header.Magic != ClothRecordingFormat::Magic || Footer.Magic != ClothRecordingFormat::Magic)
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("%s is not a cloth recording, or was not closed"), *_path);
+        Close();
+        return false;
+    }
+
+    if (Header.Version != ClothRecordingFormat::Version)
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("%s is version %d, expected %d"), *_path, Header.Version, ClothRecordingFormat::Version);
+        Close();
+        return false;
+    }
+
+    const int64 TableSize = (int64)Footer.NumFrames * sizeof(uint64);
+    if (Footer.NumFrames < 0 || (int64)Footer.FrameTableOffset + TableSize + (int64)sizeof(Footer) != Size)
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("%s has a corrupt frame table"), *_path);
+        Close();
+        return false;
+    }
+
+    FrameOffsets.SetNumUninitialized(Footer.NumFrames);
+    FMemory::Memcpy(FrameOffsets.GetData(), Data + Footer.FrameTableOffset, TableSize);
+    return true;
+}
+
+void ClothRecordingReader::Close()
+{
+    Data = nullptr;
+    Size = 0;
+
+    // The region has to go before the handle it was mapped from
+    MappedRegion.Reset();
+    MappedFile.Reset();
+    FileData.Empty();
+    FrameOffsets.Empty();
+    Header = {};
+}
+
+const uint8* ClothRecordingReader::GetFrame(int32 _frame, FFrameHeader& _outFrameHeader) const
+{
+    if (!FrameOffsets.IsValidIndex(_frame))
+    {
+        return nullptr;
+    }
+
+    // The header has to fit before it can say how big the rest of the frame is
+    if (FrameOffsets[_frame] + sizeof(FFrameHeader) > (uint64)Size)
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("Frame %d is corrupt"), _frame);
+        return nullptr;
+    }
+
+    const uint8* Frame = Data + FrameOffsets[_frame];
+    FMemory::Memcpy(&_outFrameHeader, Frame, sizeof(_outFrameHeader));
+
+    const int32 NumParticles = Header.NumHorz * Header.NumVert;
+    const int64 ExpectedSize = sizeof(FFrameHeader) + GetPositionsSize(NumParticles) + GetBurnSize(NumParticles) +
+        (int64)_outFrameHeader.NumConstraintDeltas * sizeof(FConstraintDelta);
+
+    if (_outFrameHeader.FrameSize != ExpectedSize || FrameOffsets[_frame] + ExpectedSize > (uint64)Size)
+    {
+        UE_LOG(LogClothRecording, Warning, TEXT("Frame %d is corrupt"), _frame);
+        return nullptr;
+    }
+    return Frame;
+}
+
+bool ClothRecordingReader::ApplyFrame(int32 _frame, ClothParticleStore& _particles, ClothConstraintStore& _constraints) const
+{
+    const int32 NumParticles = _particles.Num();
+    if (NumParticles != Header.NumHorz * Header.NumVert || _constraints.Num() != Header.NumConstraints)
+    {
+        return false;
+    }
+
+    FFrameHeader FrameHeader;
+    const uint8* Frame = GetFrame(_frame, FrameHeader);
+    if (Frame == nullptr)
+    {
+        return false;
+    }
+
+    // Keep the last frame as the previous positions, so velocities carry on if the simulation takes over
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        _particles.PreviousPositions[i] = _particles.Positions[i];
+    }
+    DecodePositionsInto(Frame, FrameHeader, _particles.Positions);
+
+    const uint8* Burn = Frame + sizeof(FFrameHeader) + GetPositionsSize(NumParticles);
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        _particles.BurnAmounts[i] = Burn[i] / 255.0f;
+    }
+
+    const uint8* Deltas = Burn + GetBurnSize(NumParticles);
+    for (int32 i = 0; i < FrameHeader.NumConstraintDeltas; i++)
+    {
+        FConstraintDelta Delta;
+        FMemory::Memcpy(&Delta, Deltas + i * sizeof(Delta), sizeof(Delta));
+
+        if (Delta.Index < 0 || Delta.Index >= _constraints.Num())
+        {
+            continue;
+        }
+
+        _constraints.Health[Delta.Index] = DecodeHealth(Delta.Health);
+
+        // Through DisableConstraint so the links and the broken log, and with them the mesh, follow the tear
+        if (!Delta.Enabled)
+        {
+            _constraints.DisableConstraint(Delta.Index);
+        }
+    }
+    return true;
+}
+
+bool ClothRecordingReader::DecodePositions(int32 _frame, TArray<FVector3f>& _outPositions) const
+{
+    FFrameHeader FrameHeader;
+    const uint8* Frame = GetFrame(_frame, FrameHeader);
+    if (Frame == nullptr)
+    {
+        return false;
+    }
+
+    _outPositions.SetNumUninitialized(Header.NumHorz * Header.NumVert, false);
+    DecodePositionsInto(Frame, FrameHeader, _outPositions);
+    return true;
+}
+
+static FAutoConsoleCommand CompareRecordingsCommand(
+    TEXT("cloth.CompareRecordings"),
+    TEXT("Compare the particle positions of two cloth recordings frame by frame. Args: <PathA> <PathB>"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& _args)
+    {
+        if (_args.Num() < 2)
+        {
+            UE_LOG(LogClothRecording, Warning, TEXT("cloth.CompareRecordings needs two paths"));
+            return;
+        }
+
+        ClothRecordingReader A;
+        ClothRecordingReader B;
+        if (!A.Open(_args[0]) || !B.Open(_args[1]))
+        {
+            return;
+        }
+
+        if (A.GetHeader().NumHorz != B.GetHeader().NumHorz || A.GetHeader().NumVert != B.GetHeader().NumVert)
+        {
+            UE_LOG(LogClothRecording, Warning, TEXT("Recordings are of different grids, %dx%d and %dx%d"),
+                A.GetHeader().NumHorz, A.GetHeader().NumVert, B.GetHeader().NumHorz, B.GetHeader().NumVert);
+            return;
+        }
+
+        TArray<FVector3f> PositionsA;
+        TArray<FVector3f> PositionsB;
+        float WorstError = 0.0f;
+        int32 WorstFrame = INDEX_NONE;
+
+        const int32 NumFrames = FMath::Min(A.NumFrames(), B.NumFrames());
+        for (int32 Frame = 0; Frame < NumFrames; Frame++)
+        {
+            if (!A.DecodePositions(Frame, PositionsA) || !B.DecodePositions(Frame, PositionsB))
+            {
+                return;
+            }
+
+            float FrameError = 0.0f;
+            for (int32 i = 0; i < PositionsA.Num(); i++)
+            {
+                FrameError = FMath::Max(FrameError, FVector3f::Dist(PositionsA[i], PositionsB[i]));
+            }
+
+            if (FrameError > WorstError)
+            {
+                WorstError = FrameError;
+                WorstFrame = Frame;
+            }
+        }
+
+        UE_LOG(LogClothRecording, Log, TEXT("Compared %d frames (%d and %d recorded), largest position error %.4f cm at frame %d"),
+            NumFrames, A.NumFrames(), B.NumFrames(), WorstError, WorstFrame);
+    }));
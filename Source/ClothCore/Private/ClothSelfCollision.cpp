@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothSelfCollision.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "Async/ParallelFor.h"
+
+uint32 ClothSelfCollision::HashCell(int32 _x, int32 _y, int32 _z) const
+{
+    return ((uint32)_x * 73856093u ^ (uint32)_y * 19349663u ^ (uint32)_z * 83492791u) & TableMask;
+}
+
+void ClothSelfCollision::Build(TConstArrayView<FVector3f> _positions, float _thickness)
+{
+    const int32 NumParticles = _positions.Num();
+
+    Thickness = _thickness;
+    InvCellSize = 1.0f / FMath::Max(_thickness, UE_KINDA_SMALL_NUMBER);
+
+    // Twice as many buckets as particles keeps the chains short
+    const uint32 TableSize = FMath::RoundUpToPowerOfTwo(FMath::Max(NumParticles * 2, 64));
+    TableMask = TableSize - 1;
+
+    CellStarts.Reset();
+    CellStarts.SetNumZeroed(TableSize + 1);
+    CellCursors.SetNumUninitialized(TableSize, false);
+    SortedParticles.SetNumUninitialized(NumParticles, false);
+    ParticleBuckets.SetNumUninitialized(NumParticles, false);
+
+    // Count particles per bucket
+    ParallelFor(NumParticles, [&](int32 i)
+    {
+        const FVector3f Cell = _positions[i] * InvCellSize;
+        const uint32 Bucket = HashCell(FMath::FloorToInt(Cell.X), FMath::FloorToInt(Cell.Y), FMath::FloorToInt(Cell.Z));
+        ParticleBuckets[i] = Bucket;
+        FPlatformAtomics::InterlockedIncrement(&CellStarts[Bucket + 1]);
+    });
+
+    // Prefix sum into bucket starts
+    for (uint32 Bucket = 0; Bucket < TableSize; Bucket++)
+    {
+        CellStarts[Bucket + 1] += CellStarts[Bucket];
+        CellCursors[Bucket] = CellStarts[Bucket];
+    }
+
+    // Scatter particles into their buckets, serially so each bucket lists its particles in index order
+    // and the corrections summed from it come out the same every run
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        SortedParticles[CellCursors[ParticleBuckets[i]]++] = i;
+    }
+}
+
+bool ClothSelfCollision::AreConnected(const ClothConstraintStore& _constraints, int32 _numHorz, int32 _particleA, int32 _particleB) const
+{
+    const int32 First = FMath::Min(_particleA, _particleB);
+    const int32 Second = FMath::Max(_particleA, _particleB);
+    const int32 Offset = Second - First;
+
+    // Links are owned by the left/top particle
+    const bool SameRow = First / _numHorz == Second / _numHorz;
+    if (SameRow && Offset == 1)
+    {
+        return _constraints.HasLink(First, EClothLinks::Right);
+    }
+    if (SameRow && Offset == 2)
+    {
+        return _constraints.HasLink(First, EClothLinks::RightInterwoven);
+    }
+    if (Offset == _numHorz)
+    {
+        return _constraints.HasLink(First, EClothLinks::Down);
+    }
+    if (Offset == _numHorz * 2)
+    {
+        return _constraints.HasLink(First, EClothLinks::DownInterwoven);
+    }
+    return false;
+}
+
+int32 ClothSelfCollision::Resolve(ClothParticleStore& _particles, const ClothConstraintStore& _constraints)
+{
+    const TConstArrayView<FVector3f> Positions = _particles.Positions;
+    const int32 NumParticles = Positions.Num();
+    const int32 NumHorz = _particles.GetNumHorz();
+    const float ThicknessSquared = Thickness * Thickness;
+
+    Corrections.SetNumUninitialized(NumParticles, false);
+
+    int32 Contacts = 0;
+
+    // Jacobi style, each particle only writes its own correction
+    ParallelFor(NumParticles, [&](int32 i)
+    {
+        FVector3f Correction = FVector3f::ZeroVector;
+
+        if (_particles.IsMovable(i))
+        {
+            const FVector3f Cell = Positions[i] * InvCellSize;
+            const int32 CellX = FMath::FloorToInt(Cell.X);
+            const int32 CellY = FMath::FloorToInt(Cell.Y);
+            const int32 CellZ = FMath::FloorToInt(Cell.Z);
+
+            // Different cells can hash to the same bucket, visit each bucket once
+            uint32 Visited[27];
+            int32 NumVisited = 0;
+            int32 ParticleContacts = 0;
+
+            for (int32 Z = CellZ - 1; Z <= CellZ + 1; Z++)
+            {
+                for (int32 Y = CellY - 1; Y <= CellY + 1; Y++)
+                {
+                    for (int32 X = CellX - 1; X <= CellX + 1; X++)
+                    {
+                        const uint32 Bucket = HashCell(X, Y, Z);
+
+                        bool AlreadyVisited = false;
+                        for (int32 v = 0; v < NumVisited; v++)
+                        {
+                            AlreadyVisited |= Visited[v] == Bucket;
+                        }
+                        if (AlreadyVisited)
+                        {
+                            continue;
+                        }
+                        Visited[NumVisited++] = Bucket;
+
+                        for (int32 Entry = CellStarts[Bucket]; Entry < CellStarts[Bucket + 1]; Entry++)
+                        {
+                            const int32 Other = SortedParticles[Entry];
+                            if (Other == i)
+                            {
+                                continue;
+                            }
+
+                            const FVector3f Offset = Positions[i] - Positions[Other];
+                            const float DistanceSquared = Offset.SizeSquared();
+                            if (DistanceSquared >= ThicknessSquared || DistanceSquared <= UE_SMALL_NUMBER)
+                            {
+                                continue;
+                            }
+                            if (AreConnected(_constraints, NumHorz, i, Other))
+                            {
+                                continue;
+                            }
+
+                            // Each side of the pair moves half the overlap, all of it if the other is pinned or asleep
+                            const float Distance = FMath::Sqrt(DistanceSquared);
+                            const float Share = !_particles.IsMovable(Other) ? 1.0f : 0.5f;
+                            Correction += Offset * ((Thickness - Distance) / Distance * Share);
+                            ParticleContacts++;
+                        }
+                    }
+                }
+            }
+
+            if (ParticleContacts > 0)
+            {
+                FPlatformAtomics::InterlockedAdd(&Contacts, ParticleContacts);
+            }
+        }
+
+        Corrections[i] = Correction;
+    });
+
+    ParallelFor(NumParticles, [&](int32 i)
+    {
+        _particles.Positions[i] += Corrections[i];
+    });
+
+    return Contacts;
+}
@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothSleepTiles.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "ClothCollision.h"
+#include "ClothWindField.h"
+
+void ClothSleepTiles::Initialise(int32 _numHorz, int32 _numVert)
+{
+    NumHorz = _numHorz;
+    NumTilesHorz = FMath::DivideAndRoundUp(_numHorz, TileSize);
+    NumTilesVert = FMath::DivideAndRoundUp(_numVert, TileSize);
+    NumSleeping = 0;
+
+    Tiles.Reset();
+    Tiles.SetNum(NumTilesHorz * NumTilesVert);
+
+    for (int32 TileVert = 0; TileVert < NumTilesVert; TileVert++)
+    {
+        for (int32 TileHorz = 0; TileHorz < NumTilesHorz; TileHorz++)
+        {
+            Tile& NewTile = Tiles[TileHorz + TileVert * NumTilesHorz];
+            NewTile.FirstHorz = TileHorz * TileSize;
+            NewTile.LastHorz = FMath::Min(NewTile.FirstHorz + TileSize, _numHorz);
+            NewTile.FirstVert = TileVert * TileSize;
+            NewTile.LastVert = FMath::Min(NewTile.FirstVert + TileSize, _numVert);
+        }
+    }
+}
+
+void ClothSleepTiles::Empty()
+{
+    Tiles.Empty();
+    NumTilesHorz = 0;
+    NumTilesVert = 0;
+    NumHorz = 0;
+    NumSleeping = 0;
+}
+
+void ClothSleepTiles::Update(ClothParticleStore& _particles, const ClothConstraintStore& _constraints, float _deltaTime)
+{
+    const float InvDeltaTime = 1.0f / _deltaTime;
+
+    for (int32 TileVert = 0; TileVert < NumTilesVert; TileVert++)
+    {
+        for (int32 TileHorz = 0; TileHorz < NumTilesHorz; TileHorz++)
+        {
+            Tile& CurrentTile = Tiles[TileHorz + TileVert * NumTilesHorz];
+            if (CurrentTile.Asleep)
+            {
+                continue;
+            }
+
+            // Kinetic energy, as the fastest particle's displacement over the step
+            float MaxMotionSquared = 0.0f;
+            for (int32 Vert = CurrentTile.FirstVert; Vert < CurrentTile.LastVert; Vert++)
+            {
+                for (int32 Horz = CurrentTile.FirstHorz; Horz < CurrentTile.LastHorz; Horz++)
+                {
+                    const int32 Particle = _particles.GetIndex(Horz, Vert);
+                    if (_particles.IsMovable(Particle))
+                    {
+                        MaxMotionSquared = FMath::Max(MaxMotionSquared, (_particles.Positions[Particle] - _particles.PreviousPositions[Particle]).SizeSquared());
+                    }
+                }
+            }
+
+            const float MaxSpeed = FMath::Sqrt(MaxMotionSquared) * InvDeltaTime;
+            if (MaxSpeed > WakeSpeed)
+            {
+                // Moving tiles would otherwise pull against the held edge of a sleeping neighbour
+                WakeNeighbours(_particles, TileHorz, TileVert);
+            }
+
+            bool AtRest = MaxSpeed <= SleepSpeed;
+
+            // Residual, a still tile whose constraints are still stretched is only stalled
+            for (int32 Vert = CurrentTile.FirstVert; Vert < CurrentTile.LastVert && AtRest; Vert++)
+            {
+                for (int32 Horz = CurrentTile.FirstHorz; Horz < CurrentTile.LastHorz && AtRest; Horz++)
+                {
+                    _constraints.ForEachAttachedConstraint(_particles.GetIndex(Horz, Vert), [&](int32 _constraint)
+                    {
+                        const float RestLength = _constraints.RestLengths[_constraint];
+                        const float Length = FVector3f::Dist(_particles.Positions[_constraints.ParticleA[_constraint]], _particles.Positions[_constraints.ParticleB[_constraint]]);
+                        AtRest &= FMath::Abs(Length - RestLength) <= SleepStrain * RestLength;
+                    });
+                }
+            }
+
+            CurrentTile.QuietSteps = AtRest ? CurrentTile.QuietSteps + 1 : 0;
+            if (CurrentTile.QuietSteps >= StepsToSleep)
+            {
+                Sleep(_particles, CurrentTile);
+            }
+        }
+    }
+}
+
+void ClothSleepTiles::WakeParticle(ClothParticleStore& _particles, int32 _particle)
+{
+    const int32 TileHorz = (_particle % NumHorz) / TileSize;
+    const int32 TileVert = (_particle / NumHorz) / TileSize;
+    Wake(_particles, Tiles[TileHorz + TileVert * NumTilesHorz]);
+}
+
+void ClothSleepTiles::WakeAll(ClothParticleStore& _particles)
+{
+    for (Tile& CurrentTile : Tiles)
+    {
+        Wake(_particles, CurrentTile);
+        CurrentTile.QuietSteps = 0;
+    }
+}
+
+void ClothSleepTiles::WakeOnInputChange(ClothParticleStore& _particles, const TArray<ClothCollider>& _colliders,
+    const FVector3f& _wind, const ClothWindField* _windField, const FVector3f& _windFieldOffset, float _groundHeight)
+{
+    if (NumSleeping == 0)
+    {
+        return;
+    }
+
+    for (Tile& CurrentTile : Tiles)
+    {
+        if (!CurrentTile.Asleep)
+        {
+            continue;
+        }
+
+        const FBox3f ColliderBounds = GatherColliderBounds(CurrentTile, _colliders);
+        const FVector3f Wind = SampleWind(CurrentTile, _wind, _windField, _windFieldOffset);
+
+        if (!CurrentTile.HasSurroundings)
+        {
+            CurrentTile.HasSurroundings = true;
+            CurrentTile.ColliderBounds = ColliderBounds;
+            CurrentTile.Wind = Wind;
+            CurrentTile.GroundHeight = _groundHeight;
+            continue;
+        }
+
+        // A collider resting under the tile keeps the same bounds, only one that moves, arrives or leaves wakes it
+        const bool CollidersChanged = ColliderBounds.IsValid != CurrentTile.ColliderBounds.IsValid ||
+            (ColliderBounds.IsValid && !ColliderBounds.Equals(CurrentTile.ColliderBounds, 0.1f));
+        const bool WindChanged = FVector3f::DistSquared(Wind, CurrentTile.Wind) > FMath::Square(WakeWindChange);
+        const bool GroundChanged = !FMath::IsNearlyEqual(_groundHeight, CurrentTile.GroundHeight, 0.1f);
+
+        if (CollidersChanged || WindChanged || GroundChanged)
+        {
+            Wake(_particles, CurrentTile);
+        }
+    }
+}
+
+void ClothSleepTiles::Sleep(ClothParticleStore& _particles, Tile& _tile)
+{
+    _tile.Bounds = FBox3f(ForceInit);
+    for (int32 Vert = _tile.FirstVert; Vert < _tile.LastVert; Vert++)
+    {
+        for (int32 Horz = _tile.FirstHorz; Horz < _tile.LastHorz; Horz++)
+        {
+            const int32 Particle = _particles.GetIndex(Horz, Vert);
+            _particles.SetSleeping(Particle, true);
+            _tile.Bounds += _particles.Positions[Particle];
+        }
+    }
+
+    _tile.Asleep = true;
+    _tile.HasSurroundings = false;
+    NumSleeping++;
+}
+
+void ClothSleepTiles::Wake(ClothParticleStore& _particles, Tile& _tile)
+{
+    if (!_tile.Asleep)
+    {
+        return;
+    }
+
+    for (int32 Vert = _tile.FirstVert; Vert < _tile.LastVert; Vert++)
+    {
+        for (int32 Horz = _tile.FirstHorz; Horz < _tile.LastHorz; Horz++)
+        {
+            _particles.SetSleeping(_particles.GetIndex(Horz, Vert), false);
+        }
+    }
+
+    _tile.Asleep = false;
+    _tile.QuietSteps = 0;
+    NumSleeping--;
+}
+
+void ClothSleepTiles::WakeNeighbours(ClothParticleStore& _particles, int32 _tileHorz, int32 _tileVert)
+{
+    if (NumSleeping == 0)
+    {
+        return;
+    }
+
+    // Interwoven constraints reach two particles, which never spans more than one tile
+    for (int32 TileVert = FMath::Max(_tileVert - 1, 0); TileVert <= FMath::Min(_tileVert + 1, NumTilesVert - 1); TileVert++)
+    {
+        for (int32 TileHorz = FMath::Max(_tileHorz - 1, 0); TileHorz <= FMath::Min(_tileHorz + 1, NumTilesHorz - 1); TileHorz++)
+        {
+            Wake(_particles, Tiles[TileHorz + TileVert * NumTilesHorz]);
+        }
+    }
+}
+
+FBox3f ClothSleepTiles::GatherColliderBounds(const Tile& _tile, const TArray<ClothCollider>& _colliders) const
+{
+    const FBox3f SearchBounds = _tile.Bounds.ExpandBy(ColliderMargin);
+
+    FBox3f Result(ForceInit);
+    for (const ClothCollider& Collider : _colliders)
+    {
+        if (Collider.Bounds.Intersect(SearchBounds))
+        {
+            Result += Collider.Bounds;
+        }
+    }
+    return Result;
+}
+
+FVector3f ClothSleepTiles::SampleWind(const Tile& _tile, const FVector3f& _wind, const ClothWindField* _windField, const FVector3f& _windFieldOffset) const
+{
+    if (_windField == nullptr)
+    {
+        return _wind;
+    }
+    return _wind + _windField->Sample(_tile.Bounds.GetCenter() + _windFieldOffset);
+}
@@ -0,0 +1,645 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothSolver.h"
+#include "ClothStats.h"
+
+void ClothSolver::Build()
+{
+    Empty();
+
+    CreateParticles();
+    CreateConstraints();
+}
+
+void ClothSolver::Empty()
+{
+    Particles.Empty();
+    Surface.Empty();
+    Constraints.Empty();
+    Arena.Empty();
+    ActiveConstraints.Empty();
+    ConstraintBatches.Empty();
+    Tethers.Empty();
+    Hierarchy.Empty();
+    Aerodynamics.Empty();
+    BurnFront.Empty();
+    SleepTiles.Empty();
+    NumBrokenWoken = 0;
+    Asleep = false;
+}
+
+void ClothSolver::CaptureSnapshot()
+{
+    // The snapshot is a fresh start, nothing in it should be asleep
+    SleepTiles.WakeAll(Particles);
+    Arena.CaptureSnapshot();
+}
+
+void ClothSolver::RestoreSnapshot()
+{
+    // Particles and constraints come back in one copy, the rest is rebuilt from them without allocating
+    Arena.RestoreSnapshot();
+    Constraints.OnStateRestored();
+    BurnFront.Initialise(Particles.Num(), Settings.Seed);
+    ActiveConstraints.Restart();
+    SleepTiles.Initialise(Particles.GetNumHorz(), Particles.GetNumVert());
+    NumBrokenWoken = 0;
+    Asleep = false;
+    Tethers.Build(Particles, Constraints);
+}
+
+void ClothSolver::Constrict(float _constrictedAmount)
+{
+    const int32 NumHorz = Particles.GetNumHorz();
+
+    // Calculate constricted dimensions
+    float ConstrictedWidth = Settings.ClothWidth * _constrictedAmount;
+    float ConstrictedDist = ConstrictedWidth / (NumHorz - 1);
+
+    // Determine the starting position (centered around X=0)
+    FVector3f StartPos(0);
+    StartPos.X = -ConstrictedWidth / 2.0f;  // Start at the left-most constricted point
+    StartPos.Z = Settings.ClothHeight / 2.0f;
+
+    // Iterate through horizontal particles
+    for (int32 Horz = 0; Horz < NumHorz; Horz++)
+    {
+        int32 Index = Particles.GetIndex(Horz, 0);
+
+        // Calculate new position for this particle
+        FVector3f ParticlePos = FVector3f(StartPos.X + Horz * ConstrictedDist, StartPos.Y, StartPos.Z);
+
+        // Only adjust pinned particles
+        if (Particles.GetPinned(Index))
+        {
+            Particles.Positions[Index] = ParticlePos; // Set the calculated position directly
+        }
+    }
+
+    // The pins moved, so everything hanging from them has to follow
+    SleepTiles.WakeAll(Particles);
+    Tethers.Build(Particles, Constraints);
+}
+
+void ClothSolver::Release()
+{
+    for (int32 Horz = 0; Horz < Particles.GetNumHorz(); Horz++)
+    {
+        Particles.SetPinned(Particles.GetIndex(Horz, 0), false);
+    }
+    SleepTiles.WakeAll(Particles);
+
+    // No pins left, so this drops every tether
+    Tethers.Build(Particles, Constraints);
+}
+
+bool ClothSolver::CanResample() const
+{
+    return Constraints.GetNumBroken() == 0 && BurnFront.Num() == 0;
+}
+
+void ClothSolver::Resample(int32 _numHorz, int32 _numVert)
+{
+    const int32 OldHorz = Particles.GetNumHorz();
+    const int32 OldVert = Particles.GetNumVert();
+
+    const TArray<FVector3f> OldPositions(Particles.Positions);
+    const TArray<FVector3f> OldPreviousPositions(Particles.PreviousPositions);
+    const TArray<float> OldBurnAmounts(Particles.BurnAmounts);
+
+    bool AnyPinned = false;
+    for (int32 i = 0; i < Particles.Num() && !AnyPinned; i++)
+    {
+        AnyPinned = Particles.GetPinned(i);
+    }
+
+    Settings.NumHorzParticles = _numHorz;
+    Settings.NumVertParticles = _numVert;
+    Build();
+
+    // Bilinear lookup into the old grid at the same point in the cloth's parameter space
+    auto Sample = [&](const auto& _values, float _u, float _v)
+    {
+        const int32 H0 = FMath::Min(FMath::FloorToInt(_u), OldHorz - 2);
+        const int32 V0 = FMath::Min(FMath::FloorToInt(_v), OldVert - 2);
+        const float FracH = _u - H0;
+        const float FracV = _v - V0;
+
+        const int32 Index = H0 + V0 * OldHorz;
+        const auto Top = FMath::Lerp(_values[Index], _values[Index + 1], FracH);
+        const auto Bottom = FMath::Lerp(_values[Index + OldHorz], _values[Index + OldHorz + 1], FracH);
+        return FMath::Lerp(Top, Bottom, FracV);
+    };
+
+    const float ScaleH = float(OldHorz - 1) / float(_numHorz - 1);
+    const float ScaleV = float(OldVert - 1) / float(_numVert - 1);
+
+    for (int32 Vert = 0; Vert < _numVert; Vert++)
+    {
+        for (int32 Horz = 0; Horz < _numHorz; Horz++)
+        {
+            const int32 Index = Particles.GetIndex(Horz, Vert);
+            const float U = Horz * ScaleH;
+            const float V = Vert * ScaleV;
+
+            Particles.Positions[Index] = Sample(OldPositions, U, V);
+            Particles.PreviousPositions[Index] = Sample(OldPreviousPositions, U, V);
+            Particles.BurnAmounts[Index] = Sample(OldBurnAmounts, U, V);
+        }
+    }
+
+    if (!AnyPinned)
+    {
+        Release();
+    }
+    else
+    {
+        Tethers.Build(Particles, Constraints);
+    }
+
+    Surface.UpdateCells(Constraints);
+    Surface.Compute(Particles);
+}
+
+void ClothSolver::SetTimeStep(float _timeStep)
+{
+    if (_timeStep == Settings.TimeStep)
+    {
+        return;
+    }
+
+    // Verlet's velocity is the last step's displacement, so it has to cover the new step's length
+    const float Scale = _timeStep / Settings.TimeStep;
+    for (int32 i = 0; i < Particles.Num(); i++)
+    {
+        Particles.PreviousPositions[i] = Particles.Positions[i] - (Particles.Positions[i] - Particles.PreviousPositions[i]) * Scale;
+    }
+
+    Settings.TimeStep = _timeStep;
+}
+
+void ClothSolver::CreateParticles()
+{
+    const int32 NumHorz = Settings.NumHorzParticles;
+    const int32 NumVert = Settings.NumVertParticles;
+
+    const float HorzDist = Settings.ClothWidth / (NumHorz - 1);
+    const float VertDist = Settings.ClothHeight / (NumVert - 1);
+
+    FVector3f StartPos(0);
+    StartPos.X = -Settings.ClothWidth / 2;
+    StartPos.Y = Settings.ClothHeight / 2;
+
+    // One block for the particles and constraints, CreateConstraints fills the rest of it
+    const int32 NumParticles = NumHorz * NumVert;
+    Arena.Initialise(ClothParticleStore::ArenaSize(NumParticles) + ClothConstraintStore::ArenaSize(CountConstraints(), NumParticles));
+
+    Particles.Initialise(Arena, NumHorz, NumVert);
+    Surface.Initialise(NumHorz, NumVert);
+    Aerodynamics.Initialise(NumHorz, NumVert);
+    BurnFront.Initialise(Particles.Num(), Settings.Seed);
+    SleepTiles.Initialise(NumHorz, NumVert);
+
+    for (int32 Vert = 0; Vert < NumVert; Vert++)
+    {
+        for (int32 Horz = 0; Horz < NumHorz; Horz++)
+        {
+            FVector3f ParticlePos = { StartPos.X + Horz * HorzDist, StartPos.Y, StartPos.Z - Vert * VertDist };
+
+            int32 Index = Particles.GetIndex(Horz, Vert);
+            Particles.SetInitialPosition(Index, ParticlePos);
+
+            // Pinning only if top row
+            // Always pin start and end
+            int32 numInteriorHooks = Settings.AmountOfPins - 2;
+
+            bool ShouldPin = false;
+            for (int32 i = 0; i < numInteriorHooks; i++)
+            {
+                float Percentage = 1.0f / (numInteriorHooks + 1);
+                Percentage *= i + 1;
+                Percentage *= NumHorz - 1;
+                int32 PinnedIndex = FMath::RoundToInt(Percentage);
+
+                if (PinnedIndex == Horz)
+                {
+                    ShouldPin = true;
+                    break;
+                }
+            }
+            bool Pinned = Vert == 0 && (Horz == 0 || Horz == NumHorz - 1 || ShouldPin);
+            Particles.SetPinned(Index, Pinned);
+        }
+    }
+}
+
+int32 ClothSolver::CountConstraints() const
+{
+    const int32 NumHorz = Settings.NumHorzParticles;
+    const int32 NumVert = Settings.NumVertParticles;
+
+    // One per link CreateConstraints adds
+    const int32 Down = NumHorz * (NumVert - 1);
+    const int32 DownInterwoven = NumHorz * FMath::Max(NumVert - 2, 0);
+    const int32 Right = (NumHorz - 1) * NumVert;
+    const int32 RightInterwoven = FMath::Max(NumHorz - 2, 0) * NumVert;
+    return Down + DownInterwoven + Right + RightInterwoven;
+}
+
+void ClothSolver::CreateConstraints()
+{
+    const int32 NumHorz = Settings.NumHorzParticles;
+    const int32 NumVert = Settings.NumVertParticles;
+
+    Constraints.Initialise(Arena, CountConstraints(), Particles.Num());
+
+    for (int32 Vert = 0; Vert < NumVert; Vert++)
+    {
+        for (int32 Horz = 0; Horz < NumHorz; Horz++)
+        {
+            int32 Index = Particles.GetIndex(Horz, Vert);
+
+            if (Vert < NumVert - 1)
+            {
+                // Make a vertical constraint
+                Constraints.Add(Particles, Index, Particles.GetIndex(Horz, Vert + 1), EClothLinks::Down);
+            }
+            if (Vert < NumVert - 2)
+            {
+                // Make a vertical INTERWOVEN constraint
+                Constraints.Add(Particles, Index, Particles.GetIndex(Horz, Vert + 2), EClothLinks::DownInterwoven);
+            }
+            if (Horz < NumHorz - 1)
+            {
+                // Make a horizontal constraint
+                Constraints.Add(Particles, Index, Particles.GetIndex(Horz + 1, Vert), EClothLinks::Right);
+            }
+            if (Horz < NumHorz - 2)
+            {
+                // Make a horizontal INTERWOVEN constraint
+                Constraints.Add(Particles, Index, Particles.GetIndex(Horz + 2, Vert), EClothLinks::RightInterwoven);
+            }
+        }
+    }
+
+    // Batching reorders the constraints, so build the link table afterwards
+    ConstraintBatches.Build(Constraints, Particles.Num());
+    Constraints.BuildParticleLinks(NumHorz, NumVert);
+
+    // Tether lengths come from the flat rest pose
+    Tethers.Initialise(Particles);
+    Tethers.Build(Particles, Constraints);
+
+    Hierarchy.Build(Particles, Constraints, Settings.HierarchyLevels);
+
+    ActiveConstraints.Initialise(NumVert, Settings.Seed);
+}
+
+void ClothSolver::Step()
+{
+    CLOTH_SCOPE(Step);
+
+    StepIntegrate();
+    StepSolve();
+    StepCollide();
+}
+
+void ClothSolver::StepIntegrate()
+{
+    NumBrokenAtStepStart = Constraints.GetNumBroken();
+
+    UpdateWakeTriggers();
+    if (Asleep)
+    {
+        return;
+    }
+
+    AccumulateForces();
+
+    {
+        CLOTH_SCOPE(Burn);
+        // Only the particles on the fire front are visited
+        BurnFront.UpdateBurn(Particles, Constraints, Settings.TimeStep);
+    }
+
+    {
+        CLOTH_SCOPE(Integrate);
+        // Stat macros compile out, so the work can't go inside them
+        const int32 NumIntegrated = Particles.Integrate(Settings.TimeStep);
+        INC_DWORD_STAT_BY(STAT_ClothActiveParticles, NumIntegrated);
+    }
+
+    if (Settings.UseTethers)
+    {
+        CLOTH_SCOPE(Tethers);
+        // Re-attach anything that tore away from its pin, tears made while tethers were off are caught up here too
+        Tethers.Slack = Settings.TetherSlack;
+        Tethers.Update(Particles, Constraints);
+    }
+
+    // Take out the low frequency stretch on the coarse grids first
+    if (Settings.HierarchicalSolve)
+    {
+        CLOTH_SCOPE(Hierarchy);
+        Hierarchy.UpdateLinks(Constraints);
+        Hierarchy.Solve(Particles, Settings.CoarseIterations);
+    }
+}
+
+void ClothSolver::StepSolve()
+{
+    if (Asleep)
+    {
+        return;
+    }
+
+    SolveConstraints();
+}
+
+void ClothSolver::StepCollide()
+{
+    if (Asleep)
+    {
+        return;
+    }
+
+    {
+        CLOTH_SCOPE(Burn);
+        // Fire spread
+        BurnFront.Propagate(Particles, Constraints);
+    }
+
+    SolveCollision();
+
+    {
+        CLOTH_SCOPE(Tangents);
+        // Normals for the next step's wind and for the mesh
+        Surface.UpdateCells(Constraints);
+        Surface.Compute(Particles);
+    }
+
+    if (Settings.AllowSleeping)
+    {
+        CLOTH_SCOPE(Sleep);
+        WakeTornTiles();
+        SleepTiles.Update(Particles, Constraints, Settings.TimeStep);
+    }
+
+    INC_DWORD_STAT_BY(STAT_ClothConstraintsBroken, Constraints.GetNumBroken() - NumBrokenAtStepStart);
+}
+
+void ClothSolver::UpdateWakeTriggers()
+{
+    CLOTH_SCOPE(Sleep);
+
+    if (!Settings.AllowSleeping)
+    {
+        if (SleepTiles.NumAsleep() > 0)
+        {
+            SleepTiles.WakeAll(Particles);
+        }
+        Asleep = false;
+        return;
+    }
+
+    SleepTiles.SleepSpeed = Settings.SleepSpeed;
+    SleepTiles.WakeWindChange = Settings.WakeWindChange;
+
+    // Fire, including anything ignited since the last step
+    for (int32 i = 0; i < BurnFront.Num(); i++)
+    {
+        SleepTiles.WakeParticle(Particles, BurnFront.GetParticle(i));
+    }
+
+    // Constraints torn from outside the step
+    WakeTornTiles();
+
+    SleepTiles.WakeOnInputChange(Particles, Inputs.Colliders, Inputs.WindVector, Inputs.WindField.Get(), Inputs.WindFieldOffset, Inputs.GroundHeight);
+
+    Asleep = SleepTiles.IsAllAsleep();
+    INC_DWORD_STAT_BY(STAT_ClothSleepingTiles, SleepTiles.NumAsleep());
+}
+
+void ClothSolver::WakeTornTiles()
+{
+    for (; NumBrokenWoken < Constraints.GetNumBroken(); NumBrokenWoken++)
+    {
+        const int32 Constraint = Constraints.GetBrokenConstraint(NumBrokenWoken);
+        SleepTiles.WakeParticle(Particles, Constraints.ParticleA[Constraint]);
+        SleepTiles.WakeParticle(Particles, Constraints.ParticleB[Constraint]);
+    }
+}
+
+void ClothSolver::AccumulateForces()
+{
+    CLOTH_SCOPE(Forces);
+
+    const float TimeStep = Settings.TimeStep;
+    const ClothWindField* SharedWindField = Inputs.WindField.Get();
+
+    if (Settings.AerodynamicWind)
+    {
+        Aerodynamics.DragCoefficient = Settings.DragCoefficient;
+        Aerodynamics.LiftCoefficient = Settings.LiftCoefficient;
+        Aerodynamics.Density = Settings.AirDensity;
+        Aerodynamics.Compute(Particles, Surface, Inputs.WindVector, SharedWindField, Inputs.WindFieldOffset, TimeStep);
+    }
+
+    // Picked once per step so the loop below has no per particle feature checks
+    if (Settings.AerodynamicWind)
+    {
+        AccumulateParticleForces<true, false>();
+    }
+    else if (SharedWindField != nullptr)
+    {
+        AccumulateParticleForces<false, true>();
+    }
+    else
+    {
+        AccumulateParticleForces<false, false>();
+    }
+}
+
+template<bool bAerodynamic, bool bWindField>
+void ClothSolver::AccumulateParticleForces()
+{
+    const float TimeStep = Settings.TimeStep;
+    const ClothWindField* SharedWindField = Inputs.WindField.Get();
+
+    // Accumulate forces on all particles
+    for (int32 index = 0; index < Particles.Num(); index++)
+    {
+        // Pinned and sleeping particles ignore forces, skip the wind lookup too
+        if (!Particles.IsMovable(index))
+        {
+            continue;
+        }
+
+        float Mass = 1.0f;
+
+        // Adding Acceleration
+        FVector3f gravity = { 0, 0, -981.0f * Mass * TimeStep };
+
+        // Movable was checked above, so the forces go straight in rather than through AddForce
+        if constexpr (bAerodynamic)
+        {
+            Particles.Accelerations[index] += gravity + Aerodynamics.Forces[index] * (TimeStep / Mass);
+        }
+        else
+        {
+            FVector3f cachedWindVector = Inputs.WindVector;
+            if constexpr (bWindField)
+            {
+                cachedWindVector += SharedWindField->Sample(Particles.Positions[index] + Inputs.WindFieldOffset);
+            }
+
+            float dotProduct = FVector3f::DotProduct(Surface.Normals[index], cachedWindVector);
+            float windForceMultiplier = (FMath::Abs(dotProduct) <= 0.1f) ? 0.1f : FMath::Abs(dotProduct);
+            cachedWindVector *= windForceMultiplier * Mass * TimeStep * TimeStep;
+
+            Particles.Accelerations[index] += gravity + cachedWindVector;
+        }
+    }
+}
+
+void ClothSolver::SolveConstraints()
+{
+    CLOTH_SCOPE(Constraints);
+
+    int32 NumSolved = 0;
+    const int32 UpdateSteps = Settings.UpdateSteps;
+    const float DivStep = 1.0f / (float)UpdateSteps;
+    const bool Interwoven = Settings.SimulateInterwovenConstraints;
+
+    if (Settings.SolverType == EClothSolverType::ParallelBatches)
+    {
+        // Deterministic order, no shuffle needed
+        for (int32 i = 0; i < UpdateSteps; i++)
+        {
+            SolveTethers();
+            NumSolved += ConstraintBatches.Solve(Constraints, Particles, DivStep, Interwoven);
+            SolveSelfCollision();
+        }
+    }
+    else if (Settings.SolverType == EClothSolverType::XPBD)
+    {
+        Constraints.ResetLambdas();
+
+        const float AlphaTilde = Settings.Compliance / (Settings.TimeStep * Settings.TimeStep);
+
+        LastSolverIterations = 0;
+        while (LastSolverIterations < Settings.MaxSolverIterations)
+        {
+            SolveTethers();
+
+            // Damage is taken on the first iteration only so it doesn't scale with the iteration count
+            const float DamageTime = LastSolverIterations == 0 ? 1.0f : 0.0f;
+            LastSolverResidual = ConstraintBatches.SolveXPBD(Constraints, Particles, AlphaTilde, DamageTime, Interwoven);
+            NumSolved += LastSolverResidual.NumSolved;
+            SolveSelfCollision();
+            LastSolverIterations++;
+
+            if (LastSolverResidual.MaxStrain <= Settings.SolverTolerance)
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        for (int32 i = 0; i < UpdateSteps; i++)
+        {
+            SolveTethers();
+
+            // Drops whatever broke, was pinned or fell asleep since the last pass
+            ActiveConstraints.Update(Constraints, Particles, Interwoven);
+
+            // A different sweep every substep so no direction is favoured, each row still walked in memory order.
+            // Constraints to the pins go with their row, so they aren't always solved last
+            const ClothActiveConstraints::Ordering& Order = ActiveConstraints.NextOrdering();
+            for (int32 Row : Order.Rows)
+            {
+                if (Order.Reverse)
+                {
+                    NumSolved += SolveConstraintList<false, true>(ActiveConstraints.GetMovesBRow(Row), true, DivStep);
+                    NumSolved += SolveConstraintList<true, false>(ActiveConstraints.GetMovesARow(Row), true, DivStep);
+                    NumSolved += SolveConstraintList<true, true>(ActiveConstraints.GetRow(Row), true, DivStep);
+                }
+                else
+                {
+                    NumSolved += SolveConstraintList<true, true>(ActiveConstraints.GetRow(Row), false, DivStep);
+                    NumSolved += SolveConstraintList<true, false>(ActiveConstraints.GetMovesARow(Row), false, DivStep);
+                    NumSolved += SolveConstraintList<false, true>(ActiveConstraints.GetMovesBRow(Row), false, DivStep);
+                }
+            }
+
+            SolveSelfCollision();
+        }
+    }
+
+    INC_DWORD_STAT_BY(STAT_ClothConstraintsSolved, NumSolved);
+}
+
+template<bool bMoveA, bool bMoveB>
+int32 ClothSolver::SolveConstraintList(TArrayView<const int32> _list, bool _reverse, float _deltaTime)
+{
+    // Constraints that break are disabled, the list only drops them on the next Update but each is visited once per pass
+    if (_reverse)
+    {
+        for (int32 i = _list.Num() - 1; i >= 0; i--)
+        {
+            Constraints.SolveActiveConstraint<bMoveA, bMoveB>(_list[i], Particles, _deltaTime);
+        }
+    }
+    else
+    {
+        for (int32 Constraint : _list)
+        {
+            Constraints.SolveActiveConstraint<bMoveA, bMoveB>(Constraint, Particles, _deltaTime);
+        }
+    }
+    return _list.Num();
+}
+
+void ClothSolver::SolveTethers()
+{
+    if (Settings.UseTethers)
+    {
+        CLOTH_SCOPE(Tethers);
+        Tethers.Solve(Particles);
+    }
+}
+
+void ClothSolver::SolveSelfCollision()
+{
+    if (!Settings.SelfCollision)
+    {
+        return;
+    }
+
+    CLOTH_SCOPE(SelfCollision);
+
+    SelfCollisionHash.Build(Particles.Positions, Settings.SelfCollisionThickness);
+    const int32 NumContacts = SelfCollisionHash.Resolve(Particles, Constraints);
+    INC_DWORD_STAT_BY(STAT_ClothContacts, NumContacts);
+}
+
+void ClothSolver::SolveCollision()
+{
+    CLOTH_SCOPE(Collision);
+
+    // Check for ground collision
+    Particles.CheckForGroundCollision(Inputs.GroundHeight, SleepTiles.NumAsleep() > 0);
+
+    if (Inputs.Colliders.Num() == 0)
+    {
+        return;
+    }
+
+    // Bin the colliders around where the particles are now, then resolve each particle against its cell
+    FBox3f ClothBounds(Particles.Positions.GetData(), Particles.Num());
+    ColliderGrid.Build(Inputs.Colliders, ClothBounds);
+    const int32 NumContacts = ColliderGrid.Resolve(Particles);
+    INC_DWORD_STAT_BY(STAT_ClothContacts, NumContacts);
+}
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothStats.h"
+
+DEFINE_STAT(STAT_ClothStep);
+DEFINE_STAT(STAT_ClothForces);
+DEFINE_STAT(STAT_ClothIntegrate);
+DEFINE_STAT(STAT_ClothBurn);
+DEFINE_STAT(STAT_ClothTethers);
+DEFINE_STAT(STAT_ClothHierarchy);
+DEFINE_STAT(STAT_ClothConstraints);
+DEFINE_STAT(STAT_ClothSelfCollision);
+DEFINE_STAT(STAT_ClothCollision);
+DEFINE_STAT(STAT_ClothTangents);
+DEFINE_STAT(STAT_ClothSleep);
+
+DEFINE_STAT(STAT_ClothUpdate);
+DEFINE_STAT(STAT_ClothWait);
+DEFINE_STAT(STAT_ClothGatherInputs);
+DEFINE_STAT(STAT_ClothPublish);
+DEFINE_STAT(STAT_ClothGenerateMesh);
+DEFINE_STAT(STAT_ClothMeshBuild);
+DEFINE_STAT(STAT_ClothUpload);
+
+DEFINE_STAT(STAT_ClothActiveParticles);
+DEFINE_STAT(STAT_ClothConstraintsSolved);
+DEFINE_STAT(STAT_ClothConstraintsBroken);
+DEFINE_STAT(STAT_ClothContacts);
+DEFINE_STAT(STAT_ClothBytesUploaded);
+DEFINE_STAT(STAT_ClothSleepingTiles);
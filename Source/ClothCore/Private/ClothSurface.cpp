@@ -0,0 +1,552 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothSurface.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+
+namespace
+{
+    enum ECorner { TopLeft, TopRight, BottomLeft, BottomRight };
+
+    // Triangles of a cell that use each corner
+    const uint8 CornerTriangles[4] =
+    {
+        EClothCellTriangles::TopLeft_TopRight_BottomLeft | EClothCellTriangles::BottomLeft_TopLeft_BottomRight | EClothCellTriangles::TopRight_BottomRight_TopLeft,
+        EClothCellTriangles::TopLeft_TopRight_BottomLeft | EClothCellTriangles::TopRight_BottomRight_BottomLeft | EClothCellTriangles::TopRight_BottomRight_TopLeft,
+        EClothCellTriangles::TopLeft_TopRight_BottomLeft | EClothCellTriangles::TopRight_BottomRight_BottomLeft | EClothCellTriangles::BottomLeft_TopLeft_BottomRight,
+        EClothCellTriangles::TopRight_BottomRight_BottomLeft | EClothCellTriangles::BottomLeft_TopLeft_BottomRight | EClothCellTriangles::TopRight_BottomRight_TopLeft,
+    };
+
+    const uint8 FirstTriangles = EClothCellTriangles::TopLeft_TopRight_BottomLeft | EClothCellTriangles::BottomLeft_TopLeft_BottomRight;
+    const uint8 SecondTriangles = EClothCellTriangles::TopRight_BottomRight_BottomLeft | EClothCellTriangles::TopRight_BottomRight_TopLeft;
+
+    enum EQuadrant { QuadrantTopLeft, QuadrantTopRight, QuadrantBottomRight, QuadrantBottomLeft };
+
+    // Which corner of its cell the particle is, by quadrant
+    const ECorner QuadrantCorners[EClothQuadrants::Num] = { BottomRight, BottomLeft, TopLeft, TopRight };
+
+    // Bits of ClothSurface::DirtyMarks
+    enum EDirtyMark : uint8
+    {
+        CellDirty = 1 << 0,
+        ParticleDirty = 1 << 1,
+        IndicesDirty = 1 << 2,
+    };
+
+    constexpr int32 IndicesPerCell = 6;
+
+    // Same winding convention as UKismetProceduralMeshLibrary::CalculateTangentsForMesh
+    FVector3f TriangleNormal(const FVector3f& _p0, const FVector3f& _p1, const FVector3f& _p2)
+    {
+        return FVector3f::CrossProduct(_p1 - _p2, _p0 - _p2);
+    }
+}
+
+void ClothSurface::Initialise(int32 _numHorz, int32 _numVert)
+{
+    NumHorz = _numHorz;
+    NumVert = _numVert;
+
+    const int32 Count = NumHorz * NumVert;
+
+    Normals.Init(FVector3f(0.0f, -1.0f, 0.0f), Count);
+    Tangents.Init(FVector3f(1.0f, 0.0f, 0.0f), Count);
+    CellTriangles.SetNumZeroed(Count);
+    FaceNormals.SetNumZeroed(Count * 2);
+
+    // One vertex per particle until something tears
+    VertexParticles.SetNumUninitialized(Count);
+    QuadrantVertices.SetNumUninitialized(Count * EClothQuadrants::Num);
+    for (int32 i = 0; i < Count; i++)
+    {
+        VertexParticles[i] = i;
+        for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+        {
+            QuadrantVertices[i * EClothQuadrants::Num + Quadrant] = i;
+        }
+    }
+    VertexQuadrants.SetNumZeroed(Count);
+    Indices.SetNumZeroed(Count * IndicesPerCell);
+
+    DirtyCells.Reset();
+    DirtyParticles.Reset();
+    DirtyMarks.SetNumZeroed(Count);
+
+    TopologyVersion = INDEX_NONE;
+    NumBrokenApplied = 0;
+}
+
+void ClothSurface::Empty()
+{
+    Normals.Empty();
+    Tangents.Empty();
+    CellTriangles.Empty();
+    FaceNormals.Empty();
+    VertexParticles.Empty();
+    VertexQuadrants.Empty();
+    QuadrantVertices.Empty();
+    Indices.Empty();
+    DirtyCells.Empty();
+    DirtyParticles.Empty();
+    DirtyMarks.Empty();
+
+    TopologyVersion = INDEX_NONE;
+    NumBrokenApplied = 0;
+    NumHorz = 0;
+    NumVert = 0;
+}
+
+uint8 ClothSurface::CellTrianglesFromLinks(uint8 _topLeftLinks, uint8 _topRightLinks, uint8 _bottomLeftLinks)
+{
+    const bool Top = (_topLeftLinks & EClothLinks::Right) != 0;
+    const bool Left = (_topLeftLinks & EClothLinks::Down) != 0;
+    const bool Right = (_topRightLinks & EClothLinks::Down) != 0;
+    const bool Bottom = (_bottomLeftLinks & EClothLinks::Right) != 0;
+
+    uint8 Triangles = EClothCellTriangles::None;
+
+    if (Top && Left)
+    {
+        Triangles |= EClothCellTriangles::TopLeft_TopRight_BottomLeft;
+
+        if (Right && Bottom)
+        {
+            Triangles |= EClothCellTriangles::TopRight_BottomRight_BottomLeft;
+        }
+    }
+    else if (Left && Bottom)
+    {
+        Triangles |= EClothCellTriangles::BottomLeft_TopLeft_BottomRight;
+
+        if (Right && Top)
+        {
+            Triangles |= EClothCellTriangles::TopRight_BottomRight_TopLeft;
+        }
+    }
+    return Triangles;
+}
+
+int32 ClothSurface::GetQuadrantCell(int32 _particle, int32 _quadrant) const
+{
+    const int32 Horz = _particle % NumHorz - (_quadrant == QuadrantTopLeft || _quadrant == QuadrantBottomLeft ? 1 : 0);
+    const int32 Vert = _particle / NumHorz - (_quadrant == QuadrantTopLeft || _quadrant == QuadrantTopRight ? 1 : 0);
+
+    if (Horz < 0 || Vert < 0 || Horz >= NumHorz - 1 || Vert >= NumVert - 1)
+    {
+        return INDEX_NONE;
+    }
+    return Horz + Vert * NumHorz;
+}
+
+void ClothSurface::UpdateCells(const ClothConstraintStore& _constraints)
+{
+    if (TopologyVersion == _constraints.GetTopologyVersion())
+    {
+        return;
+    }
+
+    // First build, or the constraints were restored to an earlier state and their broken log restarted
+    if (TopologyVersion == INDEX_NONE || NumBrokenApplied > _constraints.GetNumBroken())
+    {
+        RebuildAll(_constraints);
+    }
+    else
+    {
+        // Only the cells around the constraints that broke since the last update
+        for (int32 Broken = NumBrokenApplied; Broken < _constraints.GetNumBroken(); Broken++)
+        {
+            MarkBrokenConstraint(_constraints, _constraints.GetBrokenConstraint(Broken));
+        }
+
+        for (int32 Cell : DirtyCells)
+        {
+            UpdateCellTriangles(_constraints, Cell);
+        }
+
+        // The corners of a re-triangulated cell may have split
+        for (int32 Cell : DirtyCells)
+        {
+            const int32 Corners[4] = { Cell, Cell + 1, Cell + NumHorz, Cell + NumHorz + 1 };
+            for (int32 Particle : Corners)
+            {
+                if (!(DirtyMarks[Particle] & ParticleDirty))
+                {
+                    DirtyMarks[Particle] |= ParticleDirty;
+                    DirtyParticles.Add(Particle);
+                }
+            }
+        }
+
+        for (int32 Particle : DirtyParticles)
+        {
+            UpdateParticleVertices(_constraints, Particle);
+        }
+
+        // Rewrite every cell that uses a vertex of a split particle
+        for (int32 Particle : DirtyParticles)
+        {
+            for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+            {
+                const int32 Cell = GetQuadrantCell(Particle, Quadrant);
+                if (Cell != INDEX_NONE && !(DirtyMarks[Cell] & IndicesDirty))
+                {
+                    DirtyMarks[Cell] |= IndicesDirty;
+                    WriteCellIndices(Cell);
+                }
+            }
+        }
+
+        // Every mark set above sits on a dirty particle or one of its cells
+        for (int32 Particle : DirtyParticles)
+        {
+            DirtyMarks[Particle] = 0;
+            for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+            {
+                const int32 Cell = GetQuadrantCell(Particle, Quadrant);
+                if (Cell != INDEX_NONE)
+                {
+                    DirtyMarks[Cell] = 0;
+                }
+            }
+        }
+        DirtyCells.Reset();
+        DirtyParticles.Reset();
+    }
+
+    NumBrokenApplied = _constraints.GetNumBroken();
+    TopologyVersion = _constraints.GetTopologyVersion();
+}
+
+void ClothSurface::RebuildAll(const ClothConstraintStore& _constraints)
+{
+    const int32 Count = NumHorz * NumVert;
+
+    // Drop any split vertices, they are recreated from the current links
+    VertexParticles.SetNum(Count, false);
+    VertexQuadrants.SetNum(Count, false);
+    Normals.SetNum(Count, false);
+    Tangents.SetNum(Count, false);
+
+    for (int32 i = 0; i < Count; i++)
+    {
+        for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+        {
+            QuadrantVertices[i * EClothQuadrants::Num + Quadrant] = i;
+        }
+    }
+
+    for (int32 Vert = 0; Vert < NumVert - 1; Vert++)
+    {
+        for (int32 Horz = 0; Horz < NumHorz - 1; Horz++)
+        {
+            UpdateCellTriangles(_constraints, Horz + Vert * NumHorz);
+        }
+    }
+
+    for (int32 i = 0; i < Count; i++)
+    {
+        UpdateParticleVertices(_constraints, i);
+    }
+
+    for (int32 Vert = 0; Vert < NumVert - 1; Vert++)
+    {
+        for (int32 Horz = 0; Horz < NumHorz - 1; Horz++)
+        {
+            WriteCellIndices(Horz + Vert * NumHorz);
+        }
+    }
+}
+
+void ClothSurface::MarkBrokenConstraint(const ClothConstraintStore& _constraints, int32 _constraint)
+{
+    const int32 Endpoints[2] = { _constraints.ParticleA[_constraint], _constraints.ParticleB[_constraint] };
+
+    for (int32 Particle : Endpoints)
+    {
+        for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+        {
+            const int32 Cell = GetQuadrantCell(Particle, Quadrant);
+            if (Cell != INDEX_NONE && !(DirtyMarks[Cell] & CellDirty))
+            {
+                DirtyMarks[Cell] |= CellDirty;
+                DirtyCells.Add(Cell);
+            }
+        }
+    }
+}
+
+void ClothSurface::UpdateCellTriangles(const ClothConstraintStore& _constraints, int32 _cell)
+{
+    CellTriangles[_cell] = CellTrianglesFromLinks(_constraints.GetLinks(_cell),
+        _constraints.GetLinks(_cell + 1), _constraints.GetLinks(_cell + NumHorz));
+}
+
+void ClothSurface::UpdateParticleVertices(const ClothConstraintStore& _constraints, int32 _particle)
+{
+    const int32 Horz = _particle % NumHorz;
+    const int32 Vert = _particle / NumHorz;
+    int32* Vertices = &QuadrantVertices[_particle * EClothQuadrants::Num];
+
+    // Quadrants with a triangle that uses the particle
+    uint8 Present = 0;
+    for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+    {
+        const int32 Cell = GetQuadrantCell(_particle, Quadrant);
+        if (Cell != INDEX_NONE && (CellTriangles[Cell] & CornerTriangles[QuadrantCorners[Quadrant]]))
+        {
+            Present |= 1 << Quadrant;
+        }
+    }
+
+    // Edge between quadrant N and N + 1 going round: up, right, down, left
+    const bool EdgeIntact[EClothQuadrants::Num] =
+    {
+        Vert > 0 && _constraints.HasLink(_particle - NumHorz, EClothLinks::Down),
+        Horz < NumHorz - 1 && _constraints.HasLink(_particle, EClothLinks::Right),
+        Vert < NumVert - 1 && _constraints.HasLink(_particle, EClothLinks::Down),
+        Horz > 0 && _constraints.HasLink(_particle - 1, EClothLinks::Right),
+    };
+
+    // Join neighbouring quadrants across intact edges
+    int32 Groups[EClothQuadrants::Num] = { 0, 1, 2, 3 };
+    for (int32 Edge = 0; Edge < EClothQuadrants::Num; Edge++)
+    {
+        const int32 A = Edge;
+        const int32 B = (Edge + 1) % EClothQuadrants::Num;
+
+        if (EdgeIntact[Edge] && (Present & (1 << A)) && (Present & (1 << B)) && Groups[A] != Groups[B])
+        {
+            const int32 OldGroup = Groups[B];
+            for (int32& Group : Groups)
+            {
+                Group = Group == OldGroup ? Groups[A] : Group;
+            }
+        }
+    }
+
+    // Quadrant masks of each group, in order of their first quadrant
+    uint8 GroupMasks[EClothQuadrants::Num] = {};
+    int32 GroupSlots[EClothQuadrants::Num] = { INDEX_NONE, INDEX_NONE, INDEX_NONE, INDEX_NONE };
+    int32 NumGroups = 0;
+    for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+    {
+        if (Present & (1 << Quadrant))
+        {
+            int32& Slot = GroupSlots[Groups[Quadrant]];
+            if (Slot == INDEX_NONE)
+            {
+                Slot = NumGroups++;
+            }
+            GroupMasks[Slot] |= 1 << Quadrant;
+        }
+    }
+
+    // Split vertices the particle already has, oldest first, so a tear reuses them
+    int32 Extras[EClothQuadrants::Num];
+    int32 NumExtras = 0;
+    for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+    {
+        const int32 Vertex = Vertices[Quadrant];
+        bool Known = Vertex == _particle;
+        for (int32 i = 0; i < NumExtras && !Known; i++)
+        {
+            Known = Extras[i] == Vertex;
+        }
+        if (!Known)
+        {
+            Extras[NumExtras++] = Vertex;
+        }
+    }
+    Algo::Sort(MakeArrayView(Extras, NumExtras));
+
+    // Vertices of groups that vanished stay in the buffer, just unreferenced
+    VertexQuadrants[_particle] = EClothQuadrants::None;
+    for (int32 i = 0; i < NumExtras; i++)
+    {
+        VertexQuadrants[Extras[i]] = EClothQuadrants::None;
+    }
+    for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+    {
+        Vertices[Quadrant] = _particle;
+    }
+
+    for (int32 Group = 0; Group < NumGroups; Group++)
+    {
+        int32 Vertex = _particle;
+        if (Group > 0 && Group - 1 < NumExtras)
+        {
+            Vertex = Extras[Group - 1];
+        }
+        else if (Group > 0)
+        {
+            // Start the new vertex from the shading of the one it split from
+            const FVector3f Normal = Normals[_particle];
+            const FVector3f Tangent = Tangents[_particle];
+
+            Vertex = VertexParticles.Add(_particle);
+            VertexQuadrants.Add(EClothQuadrants::None);
+            Normals.Add(Normal);
+            Tangents.Add(Tangent);
+        }
+
+        VertexQuadrants[Vertex] = GroupMasks[Group];
+        for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+        {
+            if (GroupMasks[Group] & (1 << Quadrant))
+            {
+                Vertices[Quadrant] = Vertex;
+            }
+        }
+    }
+}
+
+void ClothSurface::WriteCellIndices(int32 _cell)
+{
+    const uint8 Triangles = CellTriangles[_cell];
+    int32* Slots = &Indices[_cell * IndicesPerCell];
+
+    // The vertex each corner particle uses for this cell
+    const int32 TL = QuadrantVertices[_cell * EClothQuadrants::Num + QuadrantBottomRight];
+    const int32 TR = QuadrantVertices[(_cell + 1) * EClothQuadrants::Num + QuadrantBottomLeft];
+    const int32 BL = QuadrantVertices[(_cell + NumHorz) * EClothQuadrants::Num + QuadrantTopRight];
+    const int32 BR = QuadrantVertices[(_cell + NumHorz + 1) * EClothQuadrants::Num + QuadrantTopLeft];
+
+    auto WriteTriangle = [Slots](int32 _slot, int32 _a, int32 _b, int32 _c)
+    {
+        Slots[_slot] = _a;
+        Slots[_slot + 1] = _b;
+        Slots[_slot + 2] = _c;
+    };
+
+    // Missing triangles stay in their slots as degenerates
+    if (Triangles & EClothCellTriangles::TopLeft_TopRight_BottomLeft)
+    {
+        WriteTriangle(0, TL, TR, BL);
+    }
+    else if (Triangles & EClothCellTriangles::BottomLeft_TopLeft_BottomRight)
+    {
+        WriteTriangle(0, BL, TL, BR);
+    }
+    else
+    {
+        WriteTriangle(0, TL, TL, TL);
+    }
+
+    if (Triangles & EClothCellTriangles::TopRight_BottomRight_BottomLeft)
+    {
+        WriteTriangle(3, TR, BR, BL);
+    }
+    else if (Triangles & EClothCellTriangles::TopRight_BottomRight_TopLeft)
+    {
+        WriteTriangle(3, TR, BR, TL);
+    }
+    else
+    {
+        WriteTriangle(3, TL, TL, TL);
+    }
+}
+
+void ClothSurface::Compute(const ClothParticleStore& _particles)
+{
+    ComputeFaceNormals(_particles);
+    ComputeVertexNormals(_particles);
+}
+
+void ClothSurface::ComputeFaceNormals(const ClothParticleStore& _particles)
+{
+    const TConstArrayView<FVector3f> Positions = _particles.Positions;
+
+    ParallelFor(NumVert - 1, [&](int32 Vert)
+    {
+        for (int32 Horz = 0; Horz < NumHorz - 1; Horz++)
+        {
+            const int32 Cell = Horz + Vert * NumHorz;
+            const uint8 Triangles = CellTriangles[Cell];
+
+            const FVector3f& TL = Positions[Cell];
+            const FVector3f& TR = Positions[Cell + 1];
+            const FVector3f& BL = Positions[Cell + NumHorz];
+            const FVector3f& BR = Positions[Cell + NumHorz + 1];
+
+            if (Triangles & EClothCellTriangles::TopLeft_TopRight_BottomLeft)
+            {
+                FaceNormals[Cell * 2] = TriangleNormal(TL, TR, BL);
+            }
+            else if (Triangles & EClothCellTriangles::BottomLeft_TopLeft_BottomRight)
+            {
+                FaceNormals[Cell * 2] = TriangleNormal(BL, TL, BR);
+            }
+
+            if (Triangles & EClothCellTriangles::TopRight_BottomRight_BottomLeft)
+            {
+                FaceNormals[Cell * 2 + 1] = TriangleNormal(TR, BR, BL);
+            }
+            else if (Triangles & EClothCellTriangles::TopRight_BottomRight_TopLeft)
+            {
+                FaceNormals[Cell * 2 + 1] = TriangleNormal(TR, BR, TL);
+            }
+        }
+    });
+}
+
+void ClothSurface::ComputeVertexNormals(const ClothParticleStore& _particles)
+{
+    const TConstArrayView<FVector3f> Positions = _particles.Positions;
+
+    ParallelFor(VertexParticles.Num(), [&](int32 Vertex)
+    {
+        const int32 Index = VertexParticles[Vertex];
+        const int32 Horz = Index % NumHorz;
+        const int32 Vert = Index / NumHorz;
+        const uint8 Quadrants = VertexQuadrants[Vertex];
+        FVector3f Normal = FVector3f::ZeroVector;
+
+        // Only the cells this vertex covers, so the sides of a tear shade independently
+        for (int32 Quadrant = 0; Quadrant < EClothQuadrants::Num; Quadrant++)
+        {
+            if (!(Quadrants & (1 << Quadrant)))
+            {
+                continue;
+            }
+
+            const int32 Cell = GetQuadrantCell(Index, Quadrant);
+            const uint8 Triangles = CellTriangles[Cell] & CornerTriangles[QuadrantCorners[Quadrant]];
+
+            if (Triangles & FirstTriangles)
+            {
+                Normal += FaceNormals[Cell * 2];
+            }
+            if (Triangles & SecondTriangles)
+            {
+                Normal += FaceNormals[Cell * 2 + 1];
+            }
+        }
+
+        // Torn free of every triangle, use the raw grid neighbours instead
+        const FVector3f& Left = Positions[Horz > 0 ? Index - 1 : Index];
+        const FVector3f& Right = Positions[Horz < NumHorz - 1 ? Index + 1 : Index];
+        if (Normal.IsNearlyZero())
+        {
+            const FVector3f& Up = Positions[Vert > 0 ? Index - NumHorz : Index];
+            const FVector3f& Down = Positions[Vert < NumVert - 1 ? Index + NumHorz : Index];
+            Normal = FVector3f::CrossProduct(Down - Up, Right - Left);
+        }
+
+        // Keep the last good normal if the vertex is fully degenerate
+        if (Normal.Normalize())
+        {
+            Normals[Vertex] = Normal;
+        }
+
+        // U runs along Horz, so the tangent follows the row
+        FVector3f Tangent = Right - Left;
+        Tangent -= Normals[Vertex] * FVector3f::DotProduct(Normals[Vertex], Tangent);
+        if (Tangent.Normalize())
+        {
+            Tangents[Vertex] = Tangent;
+        }
+    });
+}
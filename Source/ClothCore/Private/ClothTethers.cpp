@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothTethers.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "Async/ParallelFor.h"
+
+void ClothTethers::Initialise(const ClothParticleStore& _particles)
+{
+    RestPositions = _particles.Positions;
+    Anchors.Init(INDEX_NONE, _particles.Num());
+    Lengths.SetNumZeroed(_particles.Num());
+    TopologyVersion = INDEX_NONE;
+}
+
+void ClothTethers::Empty()
+{
+    RestPositions.Empty();
+    Anchors.Empty();
+    Lengths.Empty();
+    Queue.Empty();
+    TopologyVersion = INDEX_NONE;
+}
+
+void ClothTethers::Build(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints)
+{
+    const int32 NumParticles = _particles.Num();
+
+    // No rest pose yet, nothing to tether
+    if (RestPositions.Num() != NumParticles)
+    {
+        return;
+    }
+
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        Anchors[i] = INDEX_NONE;
+    }
+
+    // Multi source breadth first search from every pin over the intact constraints,
+    // so a torn off piece is never held by a pin it is no longer attached to
+    Queue.Reset();
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        if (_particles.GetPinned(i))
+        {
+            Anchors[i] = i;
+            Queue.Add(i);
+        }
+    }
+
+    for (int32 Head = 0; Head < Queue.Num(); Head++)
+    {
+        const int32 Particle = Queue[Head];
+        const int32 Anchor = Anchors[Particle];
+
+        _constraints.ForEachAttachedConstraint(Particle, [&](int32 _constraint)
+        {
+            const int32 A = _constraints.ParticleA[_constraint];
+            const int32 Other = A == Particle ? _constraints.ParticleB[_constraint] : A;
+
+            if (Anchors[Other] == INDEX_NONE)
+            {
+                Anchors[Other] = Anchor;
+                Queue.Add(Other);
+            }
+        });
+    }
+
+    for (int32 i = 0; i < NumParticles; i++)
+    {
+        Lengths[i] = Anchors[i] != INDEX_NONE ? FVector3f::Dist(RestPositions[i], RestPositions[Anchors[i]]) : 0.0f;
+    }
+
+    TopologyVersion = _constraints.GetTopologyVersion();
+}
+
+void ClothTethers::Update(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints)
+{
+    if (TopologyVersion != _constraints.GetTopologyVersion())
+    {
+        Build(_particles, _constraints);
+    }
+}
+
+void ClothTethers::Solve(ClothParticleStore& _particles) const
+{
+    if (Anchors.Num() != _particles.Num())
+    {
+        return;
+    }
+
+    const float Stretch = 1.0f + Slack;
+
+    // Anchors are pinned and never move here, so every particle can be projected independently
+    ParallelFor(_particles.Num(), [&](int32 i)
+    {
+        const int32 Anchor = Anchors[i];
+        if (Anchor == INDEX_NONE || Anchor == i || !_particles.IsMovable(i))
+        {
+            return;
+        }
+
+        const FVector3f Offset = _particles.Positions[i] - _particles.Positions[Anchor];
+        const float MaxLength = Lengths[i] * Stretch;
+        const float DistanceSquared = Offset.SizeSquared();
+
+        // Unilateral, only too long tethers pull
+        if (DistanceSquared > MaxLength * MaxLength)
+        {
+            _particles.Positions[i] = _particles.Positions[Anchor] + Offset * (MaxLength / FMath::Sqrt(DistanceSquared));
+        }
+    });
+}
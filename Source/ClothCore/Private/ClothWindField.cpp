@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothWindField.h"
+
+void ClothWindField::Initialise(const FBox3f& _bounds, const FIntVector& _resolution)
+{
+    Bounds = _bounds;
+    Resolution = FIntVector(FMath::Max(_resolution.X, 2), FMath::Max(_resolution.Y, 2), FMath::Max(_resolution.Z, 2));
+
+    CellSize = Bounds.GetSize() / FVector3f(Resolution.X - 1, Resolution.Y - 1, Resolution.Z - 1);
+    InvCellSize = FVector3f(1.0f / FMath::Max(CellSize.X, UE_KINDA_SMALL_NUMBER),
+        1.0f / FMath::Max(CellSize.Y, UE_KINDA_SMALL_NUMBER),
+        1.0f / FMath::Max(CellSize.Z, UE_KINDA_SMALL_NUMBER));
+
+    Velocities.SetNumZeroed(Resolution.X * Resolution.Y * Resolution.Z);
+}
+
+FVector3f ClothWindField::GetSamplePosition(int32 _x, int32 _y, int32 _z) const
+{
+    return Bounds.Min + CellSize * FVector3f(_x, _y, _z);
+}
+
+FVector3f ClothWindField::Sample(const FVector3f& _worldPosition) const
+{
+    if (Velocities.Num() == 0 || !Bounds.IsInsideOrOn(_worldPosition))
+    {
+        return FVector3f::ZeroVector;
+    }
+
+    const FVector3f GridPosition = (_worldPosition - Bounds.Min) * InvCellSize;
+
+    const int32 X = FMath::Clamp(FMath::FloorToInt(GridPosition.X), 0, Resolution.X - 2);
+    const int32 Y = FMath::Clamp(FMath::FloorToInt(GridPosition.Y), 0, Resolution.Y - 2);
+    const int32 Z = FMath::Clamp(FMath::FloorToInt(GridPosition.Z), 0, Resolution.Z - 2);
+
+    const float AlphaX = FMath::Clamp(GridPosition.X - X, 0.0f, 1.0f);
+    const float AlphaY = FMath::Clamp(GridPosition.Y - Y, 0.0f, 1.0f);
+    const float AlphaZ = FMath::Clamp(GridPosition.Z - Z, 0.0f, 1.0f);
+
+    auto Row = [&](int32 _y, int32 _z)
+    {
+        const int32 Index = GetIndex(X, _y, _z);
+        return FMath::Lerp(Velocities[Index], Velocities[Index + 1], AlphaX);
+    };
+
+    const FVector3f Near = FMath::Lerp(Row(Y, Z), Row(Y + 1, Z), AlphaY);
+    const FVector3f Far = FMath::Lerp(Row(Y, Z + 1), Row(Y + 1, Z + 1), AlphaY);
+    return FMath::Lerp(Near, Far, AlphaZ);
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothCollision.h"
+#include "ClothParticleStore.h"
+#include "ClothArena.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FClothCollisionRotatedCapsuleTest, "Cloth.Collision.RotatedCapsule",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FClothCollisionRotatedCapsuleTest::RunTest(const FString& Parameters)
+{
+    // Long and thin and tilted so its axis points down Y, the case where unsorted ends invert the bounds
+    ClothCollider Capsule;
+    Capsule.Type = EClothColliderType::Capsule;
+    Capsule.Center = FVector3f(0.0f, 0.0f, 0.0f);
+    Capsule.Rotation = FQuat4f(FVector3f(1.0f, 0.0f, 0.0f), FMath::DegreesToRadians(60.0f));
+    Capsule.HalfHeight = 50.0f;
+    Capsule.Radius = 5.0f;
+    Capsule.UpdateBounds();
+
+    const FVector3f AxisDirection = Capsule.Rotation.GetAxisZ();
+    const FVector3f EndA = Capsule.Center + AxisDirection * Capsule.HalfHeight;
+    const FVector3f EndB = Capsule.Center - AxisDirection * Capsule.HalfHeight;
+
+    TestTrue(TEXT("Bounds are valid"), Capsule.Bounds.IsValid != 0);
+    for (int32 Axis = 0; Axis < 3; Axis++)
+    {
+        TestTrue(FString::Printf(TEXT("Bounds are ordered on axis %d"), Axis), Capsule.Bounds.Min[Axis] <= Capsule.Bounds.Max[Axis]);
+    }
+    TestTrue(TEXT("Bounds hold the first end cap"), Capsule.Bounds.ExpandBy(-Capsule.Radius + UE_KINDA_SMALL_NUMBER).IsInsideOrOn(EndA));
+    TestTrue(TEXT("Bounds hold the second end cap"), Capsule.Bounds.ExpandBy(-Capsule.Radius + UE_KINDA_SMALL_NUMBER).IsInsideOrOn(EndB));
+
+    // Enough colliders for the grid to be used, the others are off the cloth
+    TArray<ClothCollider> Colliders;
+    Colliders.Add(Capsule);
+    for (int32 i = 0; i < 3; i++)
+    {
+        ClothCollider Sphere;
+        Sphere.Type = EClothColliderType::Sphere;
+        Sphere.Center = FVector3f(1000.0f + i * 100.0f, 0.0f, 0.0f);
+        Sphere.Radius = 10.0f;
+        Sphere.UpdateBounds();
+        Colliders.Add(Sphere);
+    }
+
+    ClothArena Arena;
+    Arena.Initialise(ClothParticleStore::ArenaSize(1));
+    ClothParticleStore Particles;
+    Particles.Initialise(Arena, 1, 1);
+
+    // Inside the capsule near one end, just off its axis
+    const FVector3f Inside = Capsule.Center + AxisDirection * Capsule.HalfHeight * 0.8f + FVector3f(1.0f, 0.0f, 0.0f);
+    Particles.SetInitialPosition(0, Inside);
+
+    ClothColliderGrid Grid;
+    Grid.Build(Colliders, FBox3f(FVector3f(-60.0f), FVector3f(60.0f)));
+    const int32 Contacts = Grid.Resolve(Particles);
+
+    TestEqual(TEXT("The particle inside the capsule collides"), Contacts, 1);
+
+    const FVector3f Pushed = Particles.Positions[0];
+    const float DistanceToAxis = FMath::PointDistToSegment(FVector(Pushed), FVector(EndA), FVector(EndB));
+    TestTrue(TEXT("The particle is pushed to the capsule's surface"), DistanceToAxis >= Capsule.Radius - 1.0e-3f);
+
+    return true;
+}
+
+#endif
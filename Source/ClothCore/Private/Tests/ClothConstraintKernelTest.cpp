@@ -0,0 +1,253 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothConstraintKernel.h"
+#include "ClothConstraintStore.h"
+#include "ClothParticleStore.h"
+#include "ClothArena.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ClothConstraintKernelTest
+{
+    // Not a multiple of the vector width, so the scalar tail is covered too
+    constexpr int32 NumConstraints = 257;
+    // The time step each constraint is given, the baseline solver passed 1 / UpdateSteps
+    constexpr int32 UpdateSteps = 5;
+    constexpr float DivStep = 1.0f / (float)UpdateSteps;
+
+    struct FBatch
+    {
+        ClothArena Arena;
+        ClothParticleStore Particles;
+        ClothConstraintStore Constraints;
+    };
+
+    // One coloured batch, constraint i joins particles (0, i) and (1, i) so no two share a particle.
+    // The same seed always gives the same batch
+    void BuildBatch(FBatch& _batch, int32 _seed)
+    {
+        FRandomStream Random(_seed);
+
+        const int32 NumParticles = NumConstraints * 2;
+        _batch.Arena.Initialise(ClothParticleStore::ArenaSize(NumParticles) + ClothConstraintStore::ArenaSize(NumConstraints, NumParticles));
+        _batch.Particles.Initialise(_batch.Arena, 2, NumConstraints);
+        _batch.Constraints.Initialise(_batch.Arena, NumConstraints, NumParticles);
+
+        for (int32 Particle = 0; Particle < NumParticles; Particle++)
+        {
+            _batch.Particles.SetInitialPosition(Particle, FVector3f(Random.FRandRange(-100.0f, 100.0f), Random.FRandRange(-100.0f, 100.0f), Random.FRandRange(-100.0f, 100.0f)));
+
+            const float Kind = Random.FRand();
+            if (Kind < 0.15f)
+            {
+                _batch.Particles.SetPinned(Particle, true);
+            }
+            else if (Kind < 0.3f)
+            {
+                _batch.Particles.SetSleeping(Particle, true);
+            }
+        }
+
+        ClothConstraintStore& Constraints = _batch.Constraints;
+        const float DamagePerStrain = Constraints.DamageScale * DivStep;
+
+        for (int32 Vert = 0; Vert < NumConstraints; Vert++)
+        {
+            const int32 Index = Constraints.Add(_batch.Particles, _batch.Particles.GetIndex(0, Vert), _batch.Particles.GetIndex(1, Vert), EClothLinks::Right);
+            const float Distance = Constraints.RestLengths[Index];
+
+            const float Kind = Random.FRand();
+            if (Kind < 0.25f)
+            {
+                // Past MaxStrain, with health either clearly below or clearly above this step's damage
+                const float Strain = Constraints.MaxStrain + Random.FRandRange(0.5f, 2.0f);
+                Constraints.RestLengths[Index] = Distance / (Strain + 1.0f);
+
+                const float Damage = (Strain - Constraints.MaxStrain) * DamagePerStrain;
+                Constraints.Health[Index] = Damage * (Random.FRand() < 0.5f ? 0.5f : 1.5f);
+            }
+            else
+            {
+                Constraints.RestLengths[Index] = Distance * Random.FRandRange(0.5f, 1.5f);
+            }
+
+            if (Random.FRand() < 0.1f)
+            {
+                Constraints.DisableConstraint(Index);
+            }
+        }
+    }
+
+    // The per constraint state the baseline ClothConstraint kept, with its double precision particle positions
+    struct FBaselineCloth
+    {
+        TArray<FVector> Positions;
+        TArray<bool> Pinned;
+        TArray<float> Health;
+        TArray<bool> Enabled;
+    };
+
+    FBaselineCloth CopyToBaseline(const FBatch& _batch)
+    {
+        FBaselineCloth Baseline;
+        for (int32 Particle = 0; Particle < _batch.Particles.Num(); Particle++)
+        {
+            Baseline.Positions.Add(FVector(_batch.Particles.Positions[Particle]));
+            // The baseline had no sleeping, a sleeping particle is held like a pin
+            Baseline.Pinned.Add(!_batch.Particles.IsMovable(Particle));
+        }
+        for (int32 Constraint = 0; Constraint < _batch.Constraints.Num(); Constraint++)
+        {
+            Baseline.Health.Add(_batch.Constraints.Health[Constraint]);
+            Baseline.Enabled.Add(_batch.Constraints.GetEnabled(Constraint));
+        }
+        return Baseline;
+    }
+
+    // ClothConstraint::Update as it was before the constraint store, arithmetic kept as written
+    void UpdateBaselineConstraint(FBaselineCloth& _cloth, const ClothConstraintStore& _constraints, int32 _index, float _deltaTime)
+    {
+        if (!_cloth.Enabled[_index])
+        {
+            return;
+        }
+
+        const int32 A = _constraints.ParticleA[_index];
+        const int32 B = _constraints.ParticleB[_index];
+        if (_cloth.Pinned[A] && _cloth.Pinned[B])
+        {
+            return;
+        }
+
+        const float RestDistance = _constraints.RestLengths[_index];
+        FVector CurrentOffset = _cloth.Positions[B] - _cloth.Positions[A];
+        float CurrentDistance = CurrentOffset.Size();
+        float Strain = (CurrentDistance - RestDistance) / RestDistance;
+
+        if (Strain > _constraints.MaxStrain)
+        {
+            float ExcessStrain = Strain - _constraints.MaxStrain;
+            _cloth.Health[_index] -= ExcessStrain * _constraints.DamageScale * _deltaTime;
+        }
+        if (_cloth.Health[_index] <= 0.0f)
+        {
+            _cloth.Enabled[_index] = false;
+            return;
+        }
+
+        FVector Correction = CurrentOffset * (1.0f - RestDistance / CurrentDistance);
+        FVector HalfCorrection = Correction * 0.5f;
+
+        if (!_cloth.Pinned[A] && !_cloth.Pinned[B])
+        {
+            _cloth.Positions[A] += HalfCorrection;
+            _cloth.Positions[B] -= HalfCorrection;
+        }
+        else if (!_cloth.Pinned[A])
+        {
+            _cloth.Positions[A] += Correction;
+        }
+        else if (!_cloth.Pinned[B])
+        {
+            _cloth.Positions[B] -= Correction;
+        }
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FClothConstraintKernelBaselineTest, "Cloth.ConstraintKernel.MatchesBaseline",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FClothConstraintKernelBaselineTest::RunTest(const FString& Parameters)
+{
+    using namespace ClothConstraintKernelTest;
+
+    for (int32 Seed = 0; Seed < 8; Seed++)
+    {
+        FBatch Batch;
+        BuildBatch(Batch, Seed);
+
+        FBaselineCloth Baseline = CopyToBaseline(Batch);
+        for (int32 Constraint = 0; Constraint < NumConstraints; Constraint++)
+        {
+            UpdateBaselineConstraint(Baseline, Batch.Constraints, Constraint, DivStep);
+        }
+
+        ClothConstraintKernel::SolveRange(Batch.Constraints, Batch.Particles, 0, NumConstraints, DivStep);
+
+        // The baseline kept positions in doubles, so only agree to float precision
+        for (int32 Particle = 0; Particle < Batch.Particles.Num(); Particle++)
+        {
+            const FVector3f Expected(Baseline.Positions[Particle]);
+            if (!Batch.Particles.Positions[Particle].Equals(Expected, 1.0e-2f))
+            {
+                AddError(FString::Printf(TEXT("Seed %d: particle %d at %s, baseline at %s"), Seed, Particle,
+                    *Batch.Particles.Positions[Particle].ToString(), *Expected.ToString()));
+                return false;
+            }
+        }
+
+        for (int32 Constraint = 0; Constraint < NumConstraints; Constraint++)
+        {
+            if (Batch.Constraints.GetEnabled(Constraint) != Baseline.Enabled[Constraint] ||
+                !FMath::IsNearlyEqual(Batch.Constraints.Health[Constraint], Baseline.Health[Constraint], 1.0e-3f))
+            {
+                AddError(FString::Printf(TEXT("Seed %d: constraint %d enabled %d health %f, baseline enabled %d health %f"), Seed, Constraint,
+                    Batch.Constraints.GetEnabled(Constraint), Batch.Constraints.Health[Constraint],
+                    Baseline.Enabled[Constraint], Baseline.Health[Constraint]));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FClothConstraintKernelVectorTest, "Cloth.ConstraintKernel.VectorMatchesScalar",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FClothConstraintKernelVectorTest::RunTest(const FString& Parameters)
+{
+    using namespace ClothConstraintKernelTest;
+
+    for (int32 Seed = 0; Seed < 8; Seed++)
+    {
+        FBatch Vector;
+        FBatch Scalar;
+        BuildBatch(Vector, Seed);
+        BuildBatch(Scalar, Seed);
+
+        ClothConstraintKernel::SolveRangeVector(Vector.Constraints, Vector.Particles, 0, NumConstraints, DivStep);
+        ClothConstraintKernel::SolveRangeScalar(Scalar.Constraints, Scalar.Particles, 0, NumConstraints, DivStep);
+
+        // Same operations in the same order, apart from the damage product which is grouped differently
+        for (int32 Particle = 0; Particle < Vector.Particles.Num(); Particle++)
+        {
+            if (!Vector.Particles.Positions[Particle].Equals(Scalar.Particles.Positions[Particle], 1.0e-3f))
+            {
+                AddError(FString::Printf(TEXT("Seed %d: particle %d at %s, scalar reference at %s"), Seed, Particle,
+                    *Vector.Particles.Positions[Particle].ToString(), *Scalar.Particles.Positions[Particle].ToString()));
+                return false;
+            }
+        }
+
+        for (int32 Constraint = 0; Constraint < NumConstraints; Constraint++)
+        {
+            if (Vector.Constraints.GetEnabled(Constraint) != Scalar.Constraints.GetEnabled(Constraint) ||
+                !FMath::IsNearlyEqual(Vector.Constraints.Health[Constraint], Scalar.Constraints.Health[Constraint], 1.0e-4f))
+            {
+                AddError(FString::Printf(TEXT("Seed %d: constraint %d enabled %d health %f, scalar reference enabled %d health %f"), Seed, Constraint,
+                    Vector.Constraints.GetEnabled(Constraint), Vector.Constraints.Health[Constraint],
+                    Scalar.Constraints.GetEnabled(Constraint), Scalar.Constraints.Health[Constraint]));
+                return false;
+            }
+        }
+
+        TestEqual(FString::Printf(TEXT("Seed %d broken constraints"), Seed), Vector.Constraints.GetNumBroken(), Scalar.Constraints.GetNumBroken());
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+/**
+ * The constraints the serial solver still has work to do on, split by which
+ * of their ends can move. Broken constraints, constraints between two pinned
+ * or sleeping particles and, when they are off, the interwoven ones are left
+ * out, so the solve loop never tests for any of them.
+ *
+ * Free constraints are kept sorted by their owning particle, and the fixed end
+ * lists by their owning row, so each grid row is a contiguous range of each.
+ * Instead of reshuffling, every substep sweeps the rows in the next of a few
+ * orderings fixed when the cloth is built, and a row's fixed end constraints
+ * are solved along with it rather than after the whole cloth.
+ */
+class CLOTHCORE_API ClothActiveConstraints
+{
+public:
+    // One way through the constraints
+    struct Ordering
+    {
+        // Grid rows in the order they are visited
+        TArray<int32> Rows;
+        // Sweep each row back to front
+        bool Reverse = false;
+    };
+
+    // Build the orderings for a grid _numVert rows high, the seeded one and the starting point come from _seed
+    void Initialise(int32 _numVert, int32 _seed);
+    void Empty();
+
+    // Go back to the first ordering, so a reset cloth replays the same sequence
+    void Restart();
+
+    // Rebuild if a constraint broke, a particle's mobility changed or the interwoven setting did since the last build
+    void Update(const ClothConstraintStore& _constraints, const ClothParticleStore& _particles, bool _includeInterwoven);
+
+    // The ordering for the next substep, cycling through all of them
+    const Ordering& NextOrdering();
+
+    int32 Num() const { return Free.Num() + MovesA.Num() + MovesB.Num(); }
+
+    // Free constraints owned by a grid row
+    TArrayView<const int32> GetRow(int32 _row) const { return MakeArrayView(Free.GetData() + RowStarts[_row], RowStarts[_row + 1] - RowStarts[_row]); }
+    // Constraints owned by a grid row that only move one end
+    TArrayView<const int32> GetMovesARow(int32 _row) const { return MakeArrayView(MovesA.GetData() + MovesARowStarts[_row], MovesARowStarts[_row + 1] - MovesARowStarts[_row]); }
+    TArrayView<const int32> GetMovesBRow(int32 _row) const { return MakeArrayView(MovesB.GetData() + MovesBRowStarts[_row], MovesBRowStarts[_row + 1] - MovesBRowStarts[_row]); }
+
+    // Both ends can move, sorted by ParticleA
+    TArray<int32> Free;
+    // Only ParticleA can move, grouped by ParticleA's row
+    TArray<int32> MovesA;
+    // Only ParticleB can move, grouped by ParticleA's row
+    TArray<int32> MovesB;
+
+private:
+    TArray<Ordering> Orderings;
+    int32 FirstOrdering = 0;
+    int32 NextOrderingIndex = 0;
+
+    // Free constraints of row i are Free[RowStarts[i] .. RowStarts[i + 1]), likewise for the fixed end lists
+    TArray<int32> RowStarts;
+    TArray<int32> MovesARowStarts;
+    TArray<int32> MovesBRowStarts;
+    // Scatter cursors of the fixed end lists, MovesA rows then MovesB rows
+    TArray<int32> RowCursors;
+    // Counting sort scratch, indexed by particle
+    TArray<int32> ParticleStarts;
+
+    int32 TopologyVersion = INDEX_NONE;
+    uint32 MobilityVersion = 0;
+    bool IncludeInterwoven = false;
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothSurface;
+class ClothWindField;
+
+/**
+ * Drag and lift on every cloth triangle from its velocity relative to the wind.
+ * Each cell writes the share of its triangles' forces to its four corners,
+ * then every particle gathers from the (up to four) cells around it, so
+ * the pass runs in parallel without atomics.
+ */
+class CLOTHCORE_API ClothAerodynamics
+{
+public:
+    void Initialise(int32 _numHorz, int32 _numVert);
+    void Empty();
+
+    // Fill Forces from the wind, _windField may be null. _worldOffset takes cloth space to world space
+    void Compute(const ClothParticleStore& _particles, const ClothSurface& _surface, const FVector3f& _uniformWind,
+        const ClothWindField* _windField, const FVector3f& _worldOffset, float _deltaTime);
+
+    float DragCoefficient = 1.0f;
+    float LiftCoefficient = 0.5f;
+    // Air density folded together with the particle mass
+    float Density = 0.0002f;
+
+    // Acceleration on each particle, indexed by particle
+    TArray<FVector3f> Forces;
+
+private:
+    FVector3f TriangleForce(const FVector3f& _a, const FVector3f& _b, const FVector3f& _c, const FVector3f& _relativeWind) const;
+
+    // Force on the TopLeft, TopRight, BottomLeft and BottomRight corner of each cell
+    TArray<FVector3f> CornerForces;
+
+    int32 NumHorz = 0;
+    int32 NumVert = 0;
+};
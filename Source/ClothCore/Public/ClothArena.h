@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <type_traits>
+
+/**
+ * One block of memory backing the hot arrays of a cloth's particle and
+ * constraint stores, plus a pristine copy of it. The stores carve fixed size
+ * views out of the block while the cloth is built, after which resetting the
+ * cloth is a single memcpy from the snapshot.
+ */
+class CLOTHCORE_API ClothArena
+{
+public:
+    ClothArena() = default;
+    ~ClothArena();
+
+    ClothArena(const ClothArena&) = delete;
+    ClothArena& operator=(const ClothArena&) = delete;
+
+    // Bytes a view of _num elements takes in the block, including alignment padding
+    template<typename T>
+    static SIZE_T SizeFor(int32 _num)
+    {
+        return Align(sizeof(T) * _num, Alignment);
+    }
+
+    // Allocate a zeroed block, any views and snapshot handed out before are invalid afterwards
+    void Initialise(SIZE_T _size);
+    void Empty();
+
+    // Carve the next _num elements out of the block
+    template<typename T>
+    TArrayView<T> Allocate(int32 _num)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Arena state is restored with memcpy");
+
+        const SIZE_T Bytes = SizeFor<T>(_num);
+        check(Used + Bytes <= Size);
+
+        T* Data = reinterpret_cast<T*>(Block + Used);
+        Used += Bytes;
+        return TArrayView<T>(Data, _num);
+    }
+
+    void CaptureSnapshot();
+    void RestoreSnapshot();
+    bool HasSnapshot() const { return Snapshot != nullptr; }
+
+    SIZE_T GetSize() const { return Size; }
+
+private:
+    static constexpr SIZE_T Alignment = 16;
+
+    uint8* Block = nullptr;
+    uint8* Snapshot = nullptr;
+    SIZE_T Size = 0;
+    SIZE_T Used = 0;
+};
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+/**
+ * The set of particles the fire still has work to do on.
+ * A particle joins when it is ignited and leaves once it is fully burnt, has
+ * no intact constraints left to damage and no unburnt neighbour to spread to.
+ * Every pass only walks this set, so cloth that is not on fire costs nothing.
+ */
+class CLOTHCORE_API ClothBurnFront
+{
+public:
+    // Reserve for the whole grid up front so the passes never allocate, and seed the spread
+    void Initialise(int32 _numParticles, int32 _seed);
+    void Empty();
+
+    // Add a burn to a particle and put it on the front
+    void Ignite(ClothParticleStore& _particles, int32 _index, float _burnAmount);
+
+    // Advance the burn of the front and damage the constraints of nearly burnt particles
+    void UpdateBurn(ClothParticleStore& _particles, ClothConstraintStore& _constraints, float _deltaTime);
+    // Spread to unburnt neighbours and drop particles the fire is finished with
+    void Propagate(ClothParticleStore& _particles, const ClothConstraintStore& _constraints);
+
+    int32 Num() const { return Active.Num(); }
+    int32 GetParticle(int32 _index) const { return Active[_index]; }
+
+    // Burn above which a particle damages its constraints and can spread
+    float SpreadThreshold = 0.9f;
+    // Neighbours at or below this burn can catch fire
+    float UnburntThreshold = 0.1f;
+    // Chance per step a spreading particle ignites a neighbour
+    float SpreadChance = 0.05f;
+    // Burn a neighbour catches fire with
+    float IgniteAmount = 0.5f;
+
+private:
+    TArray<int32> Active;
+    // Which neighbours catch fire, seeded so a run can be replayed
+    FRandomStream Random;
+    // Particles ignited during Propagate, merged into Active at the end
+    TArray<int32> Ignited;
+};
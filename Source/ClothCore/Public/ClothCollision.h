@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+
+enum class EClothColliderType : uint8
+{
+    Sphere,
+    Capsule,
+    Plane,
+    Box,
+};
+
+/**
+ * A collision shape in the cloth's local space.
+ * Capsules run along the local Z axis of Rotation, planes face along it.
+ */
+struct CLOTHCORE_API ClothCollider
+{
+    EClothColliderType Type = EClothColliderType::Sphere;
+    FVector3f Center = FVector3f::ZeroVector;
+    FQuat4f Rotation = FQuat4f::Identity;
+    FVector3f HalfExtents = FVector3f::ZeroVector;
+    float Radius = 0.0f;
+    float HalfHeight = 0.0f;
+
+    FBox3f Bounds = FBox3f(ForceInit);
+
+    // Fill in Bounds from the shape
+    void UpdateBounds();
+
+    // Move the shape and its bounds into a space offset by _offset
+    void Translate(const FVector3f& _offset);
+
+    // Push a point out of the shape, returns true if it was inside
+    bool ResolvePoint(FVector3f& _position) const;
+};
+
+/**
+ * Uniform grid over the cloth's bounds where each cell lists the colliders
+ * overlapping it, stored flat (counting sort) so building allocates nothing
+ * once the arrays have grown. Particles only test the colliders in their cell.
+ */
+class CLOTHCORE_API ClothColliderGrid
+{
+public:
+    // Bin the colliders that overlap the cloth
+    void Build(const TArray<ClothCollider>& _colliders, const FBox3f& _clothBounds);
+
+    // Push every particle out of the colliders in its cell, returns the number of contacts
+    int32 Resolve(ClothParticleStore& _particles) const;
+
+private:
+    int32 CellIndex(const FVector3f& _position) const;
+
+    const TArray<ClothCollider>* Colliders = nullptr;
+
+    FBox3f GridBounds = FBox3f(ForceInit);
+    FVector3f InvCellSize = FVector3f::ZeroVector;
+    FIntVector Dimensions = FIntVector::ZeroValue;
+
+    // Colliders of cell i are CellColliders[CellStarts[i] .. CellStarts[i + 1])
+    TArray<int32> CellStarts;
+    TArray<int32> CellColliders;
+
+    // Most cells along one axis
+    int32 MaxCellsPerAxis = 16;
+    // Below this many colliders every particle just tests all of them
+    int32 MinCollidersForGrid = 4;
+};
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+// Constraint residual of one solver iteration, as a fraction of rest length
+struct ClothSolverResidual
+{
+    float MaxStrain = 0.0f;
+    float RmsStrain = 0.0f;
+    int32 NumSolved = 0;
+};
+
+/**
+ * Constraints grouped by graph colour so that no two constraints in a batch
+ * share a particle. Each batch can then be solved in parallel without locks.
+ */
+class CLOTHCORE_API ClothConstraintBatches
+{
+public:
+    // Greedily colour the constraints and reorder the store so every batch is a contiguous range.
+    // Structural and interwoven constraints get separate batches
+    void Build(ClothConstraintStore& _constraints, int32 _numParticles);
+    void Empty();
+
+    // Solve every batch in order, each batch split across workers. Returns the number of constraints visited
+    int32 Solve(ClothConstraintStore& _constraints, ClothParticleStore& _particles, float _deltaTime, bool _includeInterwoven);
+
+    // One XPBD iteration over every batch, returns the residual measured before each correction
+    ClothSolverResidual SolveXPBD(ClothConstraintStore& _constraints, ClothParticleStore& _particles, float _alphaTilde, float _damageTime, bool _includeInterwoven);
+
+    int32 NumBatches() const { return Batches.Num(); }
+
+private:
+    struct Batch
+    {
+        int32 First = 0;
+        int32 Count = 0;
+        bool IsInterwoven = false;
+    };
+
+    TArray<Batch> Batches;
+
+    // Constraints handed to a worker at a time
+    int32 ChunkSize = 256;
+
+    // Per chunk residual partials, reused between iterations
+    TArray<float> ChunkMaxStrain;
+    TArray<float> ChunkSumSquaredStrain;
+    TArray<int32> ChunkSolved;
+};
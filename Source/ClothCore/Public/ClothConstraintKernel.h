@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+/**
+ * Batched distance constraint projection.
+ * Solves a contiguous range of constraints that share no particles, four at a
+ * time with VectorRegister4Float. Produces the same result as calling
+ * ClothConstraintStore::SolveConstraint on each constraint in the range.
+ */
+namespace ClothConstraintKernel
+{
+    // Number of constraints handled per vector instruction
+    constexpr int32 Width = 4;
+
+    // Solve [_first, _first + _count), choosing the vector path when available
+    CLOTHCORE_API void SolveRange(ClothConstraintStore& _constraints, ClothParticleStore& _particles,
+        int32 _first, int32 _count, float _deltaTime);
+
+    // One constraint at a time through the reference implementation
+    CLOTHCORE_API void SolveRangeScalar(ClothConstraintStore& _constraints, ClothParticleStore& _particles,
+        int32 _first, int32 _count, float _deltaTime);
+
+    CLOTHCORE_API void SolveRangeVector(ClothConstraintStore& _constraints, ClothParticleStore& _particles,
+        int32 _first, int32 _count, float _deltaTime);
+}
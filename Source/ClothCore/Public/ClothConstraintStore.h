@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ClothParticleStore.h"
+
+class ClothArena;
+
+// Per constraint state bits stored in ClothConstraintStore::Flags
+namespace EClothConstraintFlags
+{
+    enum Type : uint8
+    {
+        None = 0,
+        Enabled = 1 << 0,
+        Interwoven = 1 << 1,
+    };
+}
+
+// Grid links a particle owns, towards the particles to its right and below it
+namespace EClothLinks
+{
+    enum Type : uint8
+    {
+        None = 0,
+        Right = 1 << 0,
+        Down = 1 << 1,
+        RightInterwoven = 1 << 2,
+        DownInterwoven = 1 << 3,
+    };
+
+    constexpr int32 Num = 4;
+}
+
+/**
+ * Structure-of-arrays storage for the cloth distance constraints.
+ * Endpoints, rest lengths and health live in flat arrays so batches of
+ * constraints can be projected by ClothConstraintKernel.
+ */
+class CLOTHCORE_API ClothConstraintStore
+{
+public:
+    // Arena bytes Initialise needs
+    static SIZE_T ArenaSize(int32 _maxConstraints, int32 _numParticles);
+
+    // Carve room for up to _maxConstraints out of the arena
+    void Initialise(ClothArena& _arena, int32 _maxConstraints, int32 _numParticles);
+    // Add a constraint along a grid link of _particleA, using the current distance as rest length
+    int32 Add(const ClothParticleStore& _particles, int32 _particleA, int32 _particleB, EClothLinks::Type _link);
+    // Drop the views into the arena
+    void Empty();
+
+    // The arena was restored to a snapshot taken before any constraint broke
+    void OnStateRestored();
+
+    int32 Num() const { return NumConstraints; }
+
+    bool GetInterwoven(int32 _index) const { return (Flags[_index] & EClothConstraintFlags::Interwoven) != 0; }
+    bool GetEnabled(int32 _index) const { return (Flags[_index] & EClothConstraintFlags::Enabled) != 0; }
+
+    void DisableConstraint(int32 _index);
+
+    float GetInitialHealth() const { return InitialHealth; }
+
+    // Increases every time a constraint is disabled
+    int32 GetTopologyVersion() const { return TopologyVersion; }
+
+    // Constraints in the order they were disabled since BuildParticleLinks
+    int32 GetNumBroken() const { return NumBroken; }
+    int32 GetBrokenConstraint(int32 _index) const { return BrokenConstraints[_index]; }
+
+    void TakeDamage(int32 _index, float _damage);
+
+    // Reference scalar projection of a single constraint
+    void SolveConstraint(int32 _index, ClothParticleStore& _particles, float _deltaTime);
+
+    // SolveConstraint for a constraint known to be enabled, with the ends that can move fixed at compile time
+    template<bool bMoveA, bool bMoveB>
+    void SolveActiveConstraint(int32 _index, ClothParticleStore& _particles, float _deltaTime);
+
+    // Zero the XPBD multipliers, once per step before the first iteration
+    void ResetLambdas();
+    // XPBD projection of a single constraint, returns the residual strain before the correction
+    float SolveConstraintXPBD(int32 _index, ClothParticleStore& _particles, float _alphaTilde, float _damageTime);
+
+    // Reorder the constraints, _newOrder[i] is the old index of the constraint that moves to i
+    void Reorder(const TArray<int32>& _newOrder);
+
+    // Rebuild the per particle link table, must be called after Add/Reorder
+    void BuildParticleLinks(int32 _numHorz, int32 _numVert);
+
+    // Constant time check whether a grid link of a particle is still intact
+    bool HasLink(int32 _particle, EClothLinks::Type _link) const { return (ParticleLinks[_particle] & _link) != 0; }
+    uint8 GetLinks(int32 _particle) const { return ParticleLinks[_particle]; }
+
+    // Call _function with every intact constraint attached to a particle
+    template<typename FunctionType>
+    void ForEachAttachedConstraint(int32 _particle, FunctionType&& _function) const
+    {
+        auto Visit = [this, &_function](int32 _owner, int32 _linkBit)
+        {
+            if (ParticleLinks[_owner] & (1 << _linkBit))
+            {
+                _function(LinkConstraints[_owner * EClothLinks::Num + _linkBit]);
+            }
+        };
+
+        // Links the particle owns
+        for (int32 LinkBit = 0; LinkBit < EClothLinks::Num; LinkBit++)
+        {
+            Visit(_particle, LinkBit);
+        }
+
+        // Links owned by the particles to the left and above
+        const int32 Horz = _particle % NumHorz;
+        if (Horz >= 1)
+        {
+            Visit(_particle - 1, 0);
+        }
+        if (Horz >= 2)
+        {
+            Visit(_particle - 2, 2);
+        }
+        if (_particle >= NumHorz)
+        {
+            Visit(_particle - NumHorz, 1);
+        }
+        if (_particle >= NumHorz * 2)
+        {
+            Visit(_particle - NumHorz * 2, 3);
+        }
+    }
+
+    // Hot data, indexed by constraint, living in the cloth's ClothArena
+    TArrayView<int32> ParticleA;
+    TArrayView<int32> ParticleB;
+    TArrayView<float> RestLengths;
+    TArrayView<float> Health;
+    TArrayView<uint8> Flags;
+    TArrayView<uint8> Links;    // EClothLinks of the constraint, owned by ParticleA
+    TArrayView<float> Lambdas;  // Accumulated XPBD multipliers for the current step
+
+    // Strain above which a constraint starts taking damage
+    float MaxStrain = 7.0f;
+    float DamageScale = 10.0f;
+
+private:
+    int32 NumConstraints = 0;
+
+    // Intact EClothLinks bits, indexed by particle
+    TArrayView<uint8> ParticleLinks;
+    // Constraint along each link, indexed by particle * EClothLinks::Num + link bit index
+    TArrayView<int32> LinkConstraints;
+
+    int32 NumHorz = 0;
+
+    float InitialHealth = 20.0f;
+
+    int32 TopologyVersion = 0;
+
+    // Every constraint can only break once, so this is sized to the constraint count up front
+    TArrayView<int32> BrokenConstraints;
+    int32 NumBroken = 0;
+};
+
+template<bool bMoveA, bool bMoveB>
+void ClothConstraintStore::SolveActiveConstraint(int32 _index, ClothParticleStore& _particles, float _deltaTime)
+{
+    static_assert(bMoveA || bMoveB, "A constraint between two fixed particles has nothing to solve");
+
+    const int32 A = ParticleA[_index];
+    const int32 B = ParticleB[_index];
+    const float RestDistance = RestLengths[_index];
+
+    // Calculate the current offset and strain
+    const FVector3f CurrentOffset = _particles.Positions[B] - _particles.Positions[A];
+    const float CurrentDistance = CurrentOffset.Size();
+    const float Strain = (CurrentDistance - RestDistance) / RestDistance;
+
+    // Check if strain exceeds the maximum allowed
+    if (Strain > MaxStrain)
+    {
+        Health[_index] -= (Strain - MaxStrain) * DamageScale * _deltaTime;
+    }
+    // Disable constraint if health is depleted
+    if (Health[_index] <= 0.0f)
+    {
+        DisableConstraint(_index);
+        return;
+    }
+
+    // Apply correction for the constraint, split evenly or all of it to the free end
+    const FVector3f Correction = CurrentOffset * (1.0f - RestDistance / CurrentDistance);
+
+    if constexpr (bMoveA && bMoveB)
+    {
+        const FVector3f HalfCorrection = Correction * 0.5f;
+        _particles.Positions[A] += HalfCorrection;
+        _particles.Positions[B] -= HalfCorrection;
+    }
+    else if constexpr (bMoveA)
+    {
+        _particles.Positions[A] += Correction;
+    }
+    else
+    {
+        _particles.Positions[B] -= Correction;
+    }
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+/**
+ * Coarse versions of the particle grid, each keeping every second particle
+ * of the level below. Solving the coarsest grid first and interpolating its
+ * corrections onto the fine particles removes the low frequency stretch that
+ * Gauss-Seidel on the full grid would need O(N) sweeps to propagate.
+ */
+class CLOTHCORE_API ClothHierarchy
+{
+public:
+    // Build up to _maxLevels coarse grids from the current particle layout, taken as the rest pose
+    void Build(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints, int32 _maxLevels);
+    void Empty();
+
+    // Disable coarse constraints spanning a broken fine link, if a constraint broke since the last call
+    void UpdateLinks(const ClothConstraintStore& _constraints);
+
+    // Solve every level from the coarsest up, moving the fine particles by the interpolated corrections
+    void Solve(ClothParticleStore& _particles, int32 _iterations);
+
+    int32 NumLevels() const { return Levels.Num(); }
+
+private:
+    struct Level
+    {
+        // Fine particles between two neighbouring coarse nodes
+        int32 Stride = 1;
+        int32 NumHorz = 0;
+        int32 NumVert = 0;
+
+        // Fine particle under each coarse node
+        TArray<int32> FineIndices;
+        TArray<FVector3f> Positions;
+        TArray<FVector3f> StartPositions;
+        TArray<float> InverseMasses;
+
+        // Right and down constraints, ordered as four independent batches by direction and parity
+        TArray<int32> ParticleA;
+        TArray<int32> ParticleB;
+        TArray<float> RestLengths;
+        TArray<uint8> Enabled;
+        int32 BatchStarts[5] = {};
+    };
+
+    void BuildLevel(Level& _level, const ClothParticleStore& _particles);
+    void RefreshLinks(Level& _level, const ClothConstraintStore& _constraints) const;
+    void SolveLevel(Level& _level, int32 _iterations) const;
+    void Prolongate(const Level& _level, ClothParticleStore& _particles) const;
+
+    TArray<Level> Levels;
+
+    int32 FineNumHorz = 0;
+    int32 FineNumVert = 0;
+
+    // Constraint topology version the links were refreshed from
+    int32 TopologyVersion = INDEX_NONE;
+
+    // Coarse constraints handed to a worker at a time
+    int32 ChunkSize = 256;
+};
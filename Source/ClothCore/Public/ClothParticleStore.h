@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothArena;
+
+// Per particle state bits stored in ClothParticleStore::Flags
+namespace EClothParticleFlags
+{
+    enum Type : uint8
+    {
+        None = 0,
+        Pinned = 1 << 0,
+        OnGround = 1 << 1,
+        Burning = 1 << 2,   // On the ClothBurnFront
+        Sleeping = 1 << 3,  // In a ClothSleepTiles tile that has come to rest
+    };
+}
+
+/**
+ * Structure-of-arrays storage for the cloth particle grid.
+ * Particle (Horz, Vert) lives at index Horz + Vert * NumHorz so the
+ * integration, collision and mesh loops can walk the arrays linearly.
+ */
+class CLOTHCORE_API ClothParticleStore
+{
+public:
+    // Arena bytes Initialise needs for _numParticles
+    static SIZE_T ArenaSize(int32 _numParticles);
+
+    // Carve a grid of particles out of the arena, all at the origin and unpinned
+    void Initialise(ClothArena& _arena, int32 _numHorz, int32 _numVert);
+    // Drop the views into the arena
+    void Empty();
+
+    int32 Num() const { return Positions.Num(); }
+    int32 GetNumHorz() const { return NumHorz; }
+    int32 GetNumVert() const { return NumVert; }
+    int32 GetIndex(int32 _horz, int32 _vert) const { return _horz + _vert * NumHorz; }
+
+    void SetInitialPosition(int32 _index, const FVector3f& _position);
+
+    bool GetPinned(int32 _index) const { return (Flags[_index] & EClothParticleFlags::Pinned) != 0; }
+    void SetPinned(int32 _index, bool _isPinned);
+
+    // Sleeping particles are held in place like pins until their tile wakes
+    bool GetSleeping(int32 _index) const { return (Flags[_index] & EClothParticleFlags::Sleeping) != 0; }
+    void SetSleeping(int32 _index, bool _isSleeping);
+
+    // Neither pinned nor asleep, so forces, integration and the solvers may move it
+    bool IsMovable(int32 _index) const { return (Flags[_index] & (EClothParticleFlags::Pinned | EClothParticleFlags::Sleeping)) == 0; }
+    // Increases every time a particle is pinned, released, put to sleep or woken
+    uint32 GetMobilityVersion() const { return MobilityVersion; }
+
+    void AddForce(int32 _index, const FVector3f& _force);
+
+    void AddBurn(int32 _index, float _burnAmount);
+
+    float GetBurnRate() const { return BurnRate; }
+
+    // Verlet integrate every movable particle, returns how many moved
+    int32 Integrate(float _deltaTime);
+
+    // Push particles above the ground, _skipSleeping can only be false when nothing is asleep
+    void CheckForGroundCollision(float _groundHeight, bool _skipSleeping);
+
+    // Hot data, indexed by particle, living in the cloth's ClothArena
+    TArrayView<FVector3f> Positions;
+    TArrayView<FVector3f> PreviousPositions;
+    TArrayView<FVector3f> Accelerations;
+    TArrayView<float> InverseMasses;    // 0 when pinned or asleep
+    TArrayView<float> Damping;
+    TArrayView<float> BurnAmounts;
+    TArrayView<uint8> Flags;
+
+private:
+    template<bool bSkipSleeping>
+    void CheckForGroundCollision(float _groundHeight);
+
+    int32 NumHorz = 0;
+    int32 NumVert = 0;
+
+    uint32 MobilityVersion = 0;
+
+    float DefaultDamping = 0.0005f;
+    float GroundDamping = 0.1f;
+    float BurnRate = 0.1f;
+};
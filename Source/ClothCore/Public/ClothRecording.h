@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Pipe.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * On disk layout of a cloth recording, all little endian:
+ *
+ *   FHeader
+ *   Frame 0 .. NumFrames - 1
+ *       FFrameHeader
+ *       uint16 position per axis per particle, quantized to the frame's bounds
+ *       uint8 burn amount per particle, padded to 4 bytes
+ *       FConstraintDelta per constraint whose health or enabled state changed since the previous frame
+ *   uint64 offset of each frame
+ *   FFooter
+ *
+ * Constraint state is delta encoded from the freshly built cloth, so frames
+ * have to be applied in order starting from frame 0.
+ */
+namespace ClothRecordingFormat
+{
+    constexpr uint32 Magic = 0x43524C43; // "CLRC"
+    constexpr uint16 Version = 1;
+
+    struct FHeader
+    {
+        uint32 Magic = 0;
+        uint16 Version = 0;
+        uint16 HeaderSize = 0;
+        int32 NumHorz = 0;
+        int32 NumVert = 0;
+        int32 NumConstraints = 0;
+        float TimeStep = 0.0f;
+    };
+
+    struct FFrameHeader
+    {
+        uint32 FrameSize = 0;
+        int32 NumConstraintDeltas = 0;
+        FVector3f BoundsMin = FVector3f::ZeroVector;
+        FVector3f BoundsSize = FVector3f::ZeroVector;
+    };
+
+    struct FConstraintDelta
+    {
+        int32 Index = 0;
+        uint16 Health = 0;  // FFloat16 bits
+        uint8 Enabled = 0;
+        uint8 Padding = 0;
+    };
+
+    struct FFooter
+    {
+        uint64 FrameTableOffset = 0;
+        int32 NumFrames = 0;
+        uint32 Magic = 0;
+    };
+}
+
+/**
+ * Encodes frames on the calling thread and streams them to disk through a pipe
+ * of background tasks, so the game thread never waits on the file.
+ */
+class CLOTHCORE_API ClothRecordingWriter
+{
+public:
+    ~ClothRecordingWriter();
+
+    bool Open(const FString& _path, int32 _numHorz, int32 _numVert, int32 _numConstraints, float _timeStep);
+    // Wait for the pending writes and finish the file with the frame table
+    void Close();
+    bool IsOpen() const { return Archive.IsValid(); }
+
+    // Queue the current state as the next frame, the stores can change as soon as this returns
+    void WriteFrame(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints);
+
+private:
+    TUniquePtr<FArchive> Archive;
+    UE::Tasks::FPipe WritePipe{ TEXT("ClothRecordingWriter") };
+    UE::Tasks::FTask LastWrite;
+
+    TArray<uint64> FrameOffsets;
+    uint64 WriteOffset = 0;
+
+    // Constraint state of the previous frame, to delta against
+    TArray<uint16> LastHealth;
+    TArray<uint8> LastEnabled;
+};
+
+/**
+ * Memory maps a recording and decodes frames straight out of the mapping.
+ * Falls back to reading the whole file if the platform can't map it.
+ */
+class CLOTHCORE_API ClothRecordingReader
+{
+public:
+    ClothRecordingReader();
+    ~ClothRecordingReader();
+
+    bool Open(const FString& _path);
+    void Close();
+    bool IsOpen() const { return Data != nullptr; }
+
+    int32 NumFrames() const { return FrameOffsets.Num(); }
+    const ClothRecordingFormat::FHeader& GetHeader() const { return Header; }
+
+    // Write the frame's positions and burn into the particles and apply its constraint changes.
+    // Frames have to be applied in order from the state the cloth was recorded from
+    bool ApplyFrame(int32 _frame, ClothParticleStore& _particles, ClothConstraintStore& _constraints) const;
+
+    // Positions of a single frame, for comparing recordings
+    bool DecodePositions(int32 _frame, TArray<FVector3f>& _outPositions) const;
+
+private:
+    const uint8* GetFrame(int32 _frame, ClothRecordingFormat::FFrameHeader& _outFrameHeader) const;
+
+    TUniquePtr<IMappedFileHandle> MappedFile;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+    TArray<uint8> FileData;
+
+    const uint8* Data = nullptr;
+    int64 Size = 0;
+
+    ClothRecordingFormat::FHeader Header;
+    TArray<uint64> FrameOffsets;
+};
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+/**
+ * Particle-particle self collision over a spatial hash.
+ * The hash is rebuilt with a parallel counting sort into flat arrays, so a
+ * rebuild never allocates once the arrays have grown to the particle count.
+ * Particles still joined by a constraint are skipped, torn neighbours collide.
+ */
+class CLOTHCORE_API ClothSelfCollision
+{
+public:
+    // Hash every particle into a cell of size _thickness
+    void Build(TConstArrayView<FVector3f> _positions, float _thickness);
+
+    // Push apart unconnected particles closer than the thickness, returns the number of contacts
+    int32 Resolve(ClothParticleStore& _particles, const ClothConstraintStore& _constraints);
+
+private:
+    uint32 HashCell(int32 _x, int32 _y, int32 _z) const;
+    bool AreConnected(const ClothConstraintStore& _constraints, int32 _numHorz, int32 _particleA, int32 _particleB) const;
+
+    float Thickness = 0.0f;
+    float InvCellSize = 0.0f;
+    uint32 TableMask = 0;
+
+    // Particles of bucket i are SortedParticles[CellStarts[i] .. CellStarts[i + 1])
+    TArray<int32> CellStarts;
+    TArray<int32> CellCursors;
+    TArray<int32> SortedParticles;
+    TArray<uint32> ParticleBuckets;
+    TArray<FVector3f> Corrections;
+};
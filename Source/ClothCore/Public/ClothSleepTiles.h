@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+class ClothWindField;
+struct ClothCollider;
+
+/**
+ * The particle grid split into square tiles that fall asleep once they have
+ * stopped moving and their constraints are satisfied. Sleeping particles are
+ * flagged and held like pins, so every phase skips them, and a cloth with every
+ * tile asleep skips its step entirely. Anything that could move a sleeping
+ * tile again (a collider, the wind, fire, a tear or the pins) wakes it.
+ */
+class CLOTHCORE_API ClothSleepTiles
+{
+public:
+    // Split the grid into tiles, all awake
+    void Initialise(int32 _numHorz, int32 _numVert);
+    void Empty();
+
+    // Measure every awake tile after a step and put those that have been quiet long enough to sleep
+    void Update(ClothParticleStore& _particles, const ClothConstraintStore& _constraints, float _deltaTime);
+
+    // Wake the tile holding a particle
+    void WakeParticle(ClothParticleStore& _particles, int32 _particle);
+    // Wake everything, for changes that move the cloth as a whole such as the pins
+    void WakeAll(ClothParticleStore& _particles);
+
+    // Wake sleeping tiles whose surroundings changed since they fell asleep:
+    // different colliders close by, different wind or a different ground height
+    void WakeOnInputChange(ClothParticleStore& _particles, const TArray<ClothCollider>& _colliders,
+        const FVector3f& _wind, const ClothWindField* _windField, const FVector3f& _windFieldOffset, float _groundHeight);
+
+    int32 Num() const { return Tiles.Num(); }
+    int32 NumAsleep() const { return NumSleeping; }
+    bool IsAllAsleep() const { return Tiles.Num() > 0 && NumSleeping == Tiles.Num(); }
+
+    // Particles along each side of a tile
+    int32 TileSize = 8;
+    // Fastest a particle may move, in cm/s, for its tile to count as at rest
+    float SleepSpeed = 1.0f;
+    // Largest constraint strain a resting tile may still have
+    float SleepStrain = 0.02f;
+    // Steps a tile has to stay at rest before it sleeps
+    int32 StepsToSleep = 30;
+    // Awake tiles moving faster than this wake their sleeping neighbours
+    float WakeSpeed = 20.0f;
+    // Change in the wind at a tile that wakes it
+    float WakeWindChange = 50.0f;
+    // Distance around a tile colliders are looked for
+    float ColliderMargin = 5.0f;
+
+private:
+    struct Tile
+    {
+        // Particles of the tile are [FirstHorz, LastHorz) x [FirstVert, LastVert)
+        int32 FirstHorz = 0;
+        int32 LastHorz = 0;
+        int32 FirstVert = 0;
+        int32 LastVert = 0;
+
+        bool Asleep = false;
+        int32 QuietSteps = 0;
+
+        // Surroundings the tile fell asleep in, recorded by the first WakeOnInputChange after it did
+        bool HasSurroundings = false;
+        FBox3f Bounds = FBox3f(ForceInit);
+        FBox3f ColliderBounds = FBox3f(ForceInit);
+        FVector3f Wind = FVector3f::ZeroVector;
+        float GroundHeight = 0.0f;
+    };
+
+    void Sleep(ClothParticleStore& _particles, Tile& _tile);
+    void Wake(ClothParticleStore& _particles, Tile& _tile);
+    void WakeNeighbours(ClothParticleStore& _particles, int32 _tileHorz, int32 _tileVert);
+
+    // Union of the colliders' bounds near a tile, empty if none are
+    FBox3f GatherColliderBounds(const Tile& _tile, const TArray<ClothCollider>& _colliders) const;
+    FVector3f SampleWind(const Tile& _tile, const FVector3f& _wind, const ClothWindField* _windField, const FVector3f& _windFieldOffset) const;
+
+    TArray<Tile> Tiles;
+    int32 NumTilesHorz = 0;
+    int32 NumTilesVert = 0;
+    int32 NumHorz = 0;
+    int32 NumSleeping = 0;
+};
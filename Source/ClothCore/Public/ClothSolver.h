@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ClothArena.h"
+#include "ClothParticleStore.h"
+#include "ClothConstraintStore.h"
+#include "ClothConstraintBatches.h"
+#include "ClothActiveConstraints.h"
+#include "ClothSurface.h"
+#include "ClothCollision.h"
+#include "ClothSelfCollision.h"
+#include "ClothTethers.h"
+#include "ClothHierarchy.h"
+#include "ClothAerodynamics.h"
+#include "ClothWindField.h"
+#include "ClothBurnFront.h"
+#include "ClothSleepTiles.h"
+
+enum class EClothSolverType : uint8
+{
+    // Serial Gauss-Seidel, sweeping the grid in a different fixed order every substep
+    Shuffled,
+    // Graph coloured constraint batches, each solved with ParallelFor
+    ParallelBatches,
+    // Compliance based batches, iterating until the residual drops below a tolerance
+    XPBD,
+};
+
+// Everything the solver is configured with, the first block only takes effect on Build
+struct CLOTHCORE_API ClothSolverSettings
+{
+    float ClothWidth = 200.0f;    // in cm
+    float ClothHeight = 200.0f;
+    int32 NumHorzParticles = 30;
+    int32 NumVertParticles = 30;
+    int32 AmountOfPins = 5;
+    int32 HierarchyLevels = 4;
+
+    float TimeStep = 0.016f;
+    int32 UpdateSteps = 5;
+    EClothSolverType SolverType = EClothSolverType::Shuffled;
+    bool SimulateInterwovenConstraints = true;
+
+    bool UseTethers = true;
+    float TetherSlack = 0.02f;
+
+    bool HierarchicalSolve = false;
+    int32 CoarseIterations = 4;
+
+    float Compliance = 0.00001f;
+    float SolverTolerance = 0.001f;
+    int32 MaxSolverIterations = 20;
+
+    bool AerodynamicWind = false;
+    float DragCoefficient = 1.0f;
+    float LiftCoefficient = 0.5f;
+    float AirDensity = 0.0002f;
+
+    bool SelfCollision = false;
+    float SelfCollisionThickness = 3.0f;
+
+    // Fixes the constraint orderings and fire spread, the same seed replays the same simulation
+    int32 Seed = 1234;
+
+    bool AllowSleeping = true;
+    float SleepSpeed = 1.0f;    // in cm/s
+    float WakeWindChange = 50.0f;
+};
+
+// World state gathered for the next step, everything in the cloth's local space
+struct CLOTHCORE_API ClothSolverInputs
+{
+    FVector3f WindVector = FVector3f::ZeroVector;
+    // Shared wind field, sampled at the particle position plus WindFieldOffset
+    FClothWindFieldPtr WindField;
+    FVector3f WindFieldOffset = FVector3f::ZeroVector;
+
+    float GroundHeight = 0.0f;
+    TArray<ClothCollider> Colliders;
+};
+
+/**
+ * The cloth simulation without any engine dependencies: builds the particle
+ * grid and its constraints, then advances it one fixed step at a time.
+ * ACloth drives one from the world, ClothBenchmark runs it headless.
+ * Step only touches the solver's own state, so it can run on a worker.
+ */
+class CLOTHCORE_API ClothSolver
+{
+public:
+    // Allocate and build a flat, pinned cloth from Settings
+    void Build();
+    void Empty();
+
+    // How many constraints Build adds for the current grid size
+    int32 CountConstraints() const;
+
+    // Remember the current state so RestoreSnapshot can go back to it without rebuilding
+    void CaptureSnapshot();
+    bool HasSnapshot() const { return Arena.HasSnapshot(); }
+    void RestoreSnapshot();
+
+    // Move the pinned top row so the cloth spans _constrictedAmount of its width
+    void Constrict(float _constrictedAmount);
+    // Unpin the top row
+    void Release();
+
+    // Resampling can't carry tears or fire across, so only intact cloth that isn't burning can change resolution
+    bool CanResample() const;
+    // Rebuild with a different grid resolution, interpolating positions, velocities and burn from the current grid
+    void Resample(int32 _numHorz, int32 _numVert);
+
+    // Change TimeStep, rescaling the velocities Verlet keeps in the previous positions to match
+    void SetTimeStep(float _timeStep);
+
+    // One TimeStep of forces, integration, constraints, burning and collision
+    void Step();
+
+    // Every tile was asleep, so the last step didn't move anything
+    bool IsAsleep() const { return Asleep; }
+
+    // Step split into its phases, so many cloths can run each phase side by side.
+    // Forces, burning, integration and the coarse grids
+    void StepIntegrate();
+    // Tethers, constraints and self collision
+    void StepSolve();
+    // Fire spread, collision and the surface
+    void StepCollide();
+
+    ClothSolverSettings Settings;
+    ClothSolverInputs Inputs;
+
+    ClothParticleStore Particles;
+    ClothConstraintStore Constraints;
+    // Normals and tangents of the particle grid
+    ClothSurface Surface;
+    // Particles the fire is still working on
+    ClothBurnFront BurnFront;
+    // Regions of the grid that have come to rest
+    ClothSleepTiles SleepTiles;
+
+    // Iterations and residual of the last XPBD step
+    int32 LastSolverIterations = 0;
+    ClothSolverResidual LastSolverResidual;
+
+private:
+    void CreateParticles();
+    void CreateConstraints();
+
+    void AccumulateForces();
+    // The per particle force loop, specialised on the wind model so it doesn't branch per particle
+    template<bool bAerodynamic, bool bWindField>
+    void AccumulateParticleForces();
+
+    void SolveConstraints();
+    // Serial projection of part of ActiveConstraints, front to back or back to front, returns how many were solved
+    template<bool bMoveA, bool bMoveB>
+    int32 SolveConstraintList(TArrayView<const int32> _list, bool _reverse, float _deltaTime);
+    // Unilateral long range attachment pass
+    void SolveTethers();
+    // Rebuild the spatial hash and separate overlapping particles
+    void SolveSelfCollision();
+    void SolveCollision();
+
+    // Wake the tiles the fire, a tear or a change in the inputs reached, then check whether anything is left awake
+    void UpdateWakeTriggers();
+    void WakeTornTiles();
+
+    // Backs the particle and constraint stores, with a pristine copy for resets
+    ClothArena Arena;
+
+    // Constraints the serial solver visits and the orders it sweeps them in
+    ClothActiveConstraints ActiveConstraints;
+    // The constraints grouped into independent batches for the parallel solver
+    ClothConstraintBatches ConstraintBatches;
+    // Per triangle drag and lift
+    ClothAerodynamics Aerodynamics;
+    // Long range attachments to the pins
+    ClothTethers Tethers;
+    // Coarse grids solved before the full resolution constraints
+    ClothHierarchy Hierarchy;
+
+    ClothSelfCollision SelfCollisionHash;
+    // Per step broadphase grid over the particles
+    ClothColliderGrid ColliderGrid;
+
+    int32 NumBrokenAtStepStart = 0;
+    // Broken constraints whose tiles have been woken
+    int32 NumBrokenWoken = 0;
+    bool Asleep = false;
+};
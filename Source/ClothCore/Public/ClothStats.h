@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Everything shown by "stat Cloth"
+DECLARE_STATS_GROUP(TEXT("Cloth"), STATGROUP_Cloth, STATCAT_Advanced);
+
+// Simulation phases, run on whichever thread steps the cloth
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Step"), STAT_ClothStep, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Forces"), STAT_ClothForces, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Integrate"), STAT_ClothIntegrate, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Burn"), STAT_ClothBurn, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tethers"), STAT_ClothTethers, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hierarchy"), STAT_ClothHierarchy, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Constraint Substeps"), STAT_ClothConstraints, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Self Collision"), STAT_ClothSelfCollision, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collision"), STAT_ClothCollision, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Normals And Tangents"), STAT_ClothTangents, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sleep"), STAT_ClothSleep, STATGROUP_Cloth, CLOTHCORE_API);
+
+// Game thread phases
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update"), STAT_ClothUpdate, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Wait For Simulation"), STAT_ClothWait, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gather Inputs"), STAT_ClothGatherInputs, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Publish Render State"), STAT_ClothPublish, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Mesh"), STAT_ClothGenerateMesh, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh Build"), STAT_ClothMeshBuild, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Upload"), STAT_ClothUpload, STATGROUP_Cloth, CLOTHCORE_API);
+
+// Per frame totals over every cloth
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Active Particles"), STAT_ClothActiveParticles, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Constraints Solved"), STAT_ClothConstraintsSolved, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Constraints Broken"), STAT_ClothConstraintsBroken, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Collision Contacts"), STAT_ClothContacts, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bytes Uploaded"), STAT_ClothBytesUploaded, STATGROUP_Cloth, CLOTHCORE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sleeping Tiles"), STAT_ClothSleepingTiles, STATGROUP_Cloth, CLOTHCORE_API);
+
+// Cycle stat for "stat Cloth" plus a named scope for Unreal Insights, e.g. CLOTH_SCOPE(Integrate)
+#define CLOTH_SCOPE(_name) \
+    SCOPE_CYCLE_COUNTER(STAT_Cloth##_name); \
+    TRACE_CPUPROFILER_EVENT_SCOPE(Cloth##_name)
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+// Triangles present in a grid cell, written to the index buffer by ClothSurface::WriteCellIndices
+namespace EClothCellTriangles
+{
+    enum Type : uint8
+    {
+        None = 0,
+        TopLeft_TopRight_BottomLeft = 1 << 0,
+        TopRight_BottomRight_BottomLeft = 1 << 1,
+        BottomLeft_TopLeft_BottomRight = 1 << 2,
+        TopRight_BottomRight_TopLeft = 1 << 3,
+    };
+}
+
+// The (up to four) cells around a particle, bit N is quadrant N going round the particle
+namespace EClothQuadrants
+{
+    enum Type : uint8
+    {
+        None = 0,
+        TopLeft = 1 << 0,       // Particle is the cell's bottom right corner
+        TopRight = 1 << 1,      // Particle is the cell's bottom left corner
+        BottomRight = 1 << 2,   // Particle is the cell's top left corner
+        BottomLeft = 1 << 3,    // Particle is the cell's top right corner
+    };
+
+    constexpr int32 Num = 4;
+}
+
+/**
+ * Render topology, normals and tangents computed straight from the particle grid.
+ * A particle gets one render vertex per group of surrounding cells that are
+ * still joined through an intact edge, so a tear splits the vertex and shading
+ * no longer bleeds across it. The first NumParticles vertices are the particles'
+ * own, split vertices are appended. Every cell owns six fixed slots in the
+ * index buffer, so a tear only rewrites the cells around it.
+ */
+class CLOTHCORE_API ClothSurface
+{
+public:
+    void Initialise(int32 _numHorz, int32 _numVert);
+    void Empty();
+
+    // Which triangles a cell has, from the intact links of its corners
+    static uint8 CellTrianglesFromLinks(uint8 _topLeftLinks, uint8 _topRightLinks, uint8 _bottomLeftLinks);
+
+    // Re-triangulate and split the vertices around every constraint that broke since the last call
+    void UpdateCells(const ClothConstraintStore& _constraints);
+
+    // Recompute every normal and tangent from the current particle positions
+    void Compute(const ClothParticleStore& _particles);
+
+    // Cells are indexed by their top left particle
+    const TArray<uint8>& GetCellTriangles() const { return CellTriangles; }
+    int32 GetTopologyVersion() const { return TopologyVersion; }
+
+    int32 NumVertices() const { return VertexParticles.Num(); }
+    // Particle each render vertex follows
+    const TArray<int32>& GetVertexParticles() const { return VertexParticles; }
+    // Six slots per cell, first then second triangle, degenerate when the triangle is missing
+    const TArray<int32>& GetIndices() const { return Indices; }
+
+    // Indexed by render vertex
+    TArray<FVector3f> Normals;
+    TArray<FVector3f> Tangents;
+
+private:
+    void RebuildAll(const ClothConstraintStore& _constraints);
+    void MarkBrokenConstraint(const ClothConstraintStore& _constraints, int32 _constraint);
+    void UpdateCellTriangles(const ClothConstraintStore& _constraints, int32 _cell);
+    // Group the particle's quadrants into render vertices
+    void UpdateParticleVertices(const ClothConstraintStore& _constraints, int32 _particle);
+    void WriteCellIndices(int32 _cell);
+    int32 GetQuadrantCell(int32 _particle, int32 _quadrant) const;
+
+    void ComputeFaceNormals(const ClothParticleStore& _particles);
+    void ComputeVertexNormals(const ClothParticleStore& _particles);
+
+    TArray<uint8> CellTriangles;
+    // Two (area weighted) face normals per cell, first and second triangle
+    TArray<FVector3f> FaceNormals;
+
+    TArray<int32> VertexParticles;
+    // EClothQuadrants the render vertex covers
+    TArray<uint8> VertexQuadrants;
+    // Render vertex of each quadrant, indexed by particle * EClothQuadrants::Num + quadrant
+    TArray<int32> QuadrantVertices;
+    TArray<int32> Indices;
+
+    // Cells and particles touched by the current update, deduplicated with DirtyMarks
+    TArray<int32> DirtyCells;
+    TArray<int32> DirtyParticles;
+    TArray<uint8> DirtyMarks;
+
+    // Constraint topology version the cells were built from
+    int32 TopologyVersion = INDEX_NONE;
+    // Entries of the constraints' broken log already applied
+    int32 NumBrokenApplied = 0;
+
+    int32 NumHorz = 0;
+    int32 NumVert = 0;
+};
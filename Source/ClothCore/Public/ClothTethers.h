@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothConstraintStore;
+
+/**
+ * Long range attachments from every particle to the nearest pin it is still
+ * connected to. A tether only pulls once the particle is further from its pin
+ * than in the rest pose, so stretch is removed in one pass instead of having
+ * to travel down the grid one constraint at a time.
+ */
+class CLOTHCORE_API ClothTethers
+{
+public:
+    // Remember the rest pose, tether lengths are measured in it
+    void Initialise(const ClothParticleStore& _particles);
+    void Empty();
+
+    // Re-attach every particle to its nearest connected pin, call when pins change
+    void Build(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints);
+    // Rebuild if a constraint broke since the last build
+    void Update(const ClothParticleStore& _particles, const ClothConstraintStore& _constraints);
+
+    // Pull every particle that is too far from its pin back onto the tether sphere
+    void Solve(ClothParticleStore& _particles) const;
+
+    // Tethers may stretch this fraction past their rest length before pulling
+    float Slack = 0.0f;
+
+private:
+    TArray<FVector3f> RestPositions;
+
+    // Pinned particle each particle is tethered to, INDEX_NONE if none
+    TArray<int32> Anchors;
+    TArray<float> Lengths;
+
+    // Breadth first search frontier, kept between builds
+    TArray<int32> Queue;
+
+    // Constraint topology version the tethers were built from
+    int32 TopologyVersion = INDEX_NONE;
+};
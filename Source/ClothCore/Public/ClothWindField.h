@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Wind velocities sampled on a regular 3D grid in world space.
+ * Built by the game (UClothWindSubsystem) and shared read only by every cloth, so it
+ * can be sampled from simulation workers while the game thread builds the next one.
+ */
+class CLOTHCORE_API ClothWindField
+{
+public:
+    void Initialise(const FBox3f& _bounds, const FIntVector& _resolution);
+
+    // Trilinear sample, zero outside the bounds
+    FVector3f Sample(const FVector3f& _worldPosition) const;
+
+    int32 GetIndex(int32 _x, int32 _y, int32 _z) const { return _x + (_y + _z * Resolution.Y) * Resolution.X; }
+    FVector3f GetSamplePosition(int32 _x, int32 _y, int32 _z) const;
+
+    const FBox3f& GetBounds() const { return Bounds; }
+    const FIntVector& GetResolution() const { return Resolution; }
+
+    // Wind velocity at every grid point, indexed by GetIndex
+    TArray<FVector3f> Velocities;
+
+private:
+    FBox3f Bounds = FBox3f(ForceInit);
+    FIntVector Resolution = FIntVector::ZeroValue;
+    FVector3f CellSize = FVector3f::ZeroVector;
+    FVector3f InvCellSize = FVector3f::ZeroVector;
+};
+
+using FClothWindFieldPtr = TSharedPtr<const ClothWindField, ESPMode::ThreadSafe>;
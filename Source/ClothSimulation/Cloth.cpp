@@ -1,28 +1,22 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Cloth.h"
-#include "ClothParticle.h"
-#include "ClothConstraint.h"
-#include "ClothSphere.h"
-#include "Kismet/GameplayStatics.h"
+#include "ClothStats.h"
+#include "ClothColliderSubsystem.h"
+#include "ClothSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "DrawDebugHelpers.h"
 #include "ProceduralMeshComponent.h"
-#include "KismetProceduralMeshLibrary.h"
-
-// Helper function to randomise TArray
-template<typename T>
-void ShuffleArray(TArray<T>& Array)
-{
-	// Iterate from the last element to the second element
-	for (int32 i = Array.Num() - 1; i > 0; --i)
-	{
-		// Generate a random index from 0 to i
-		int32 RandomIndex = FMath::RandRange(0, i);
+#include "Tasks/Task.h"
+#include "Misc/Paths.h"
+#include "Kismet/GameplayStatics.h"
 
-		// Swap the current element with the random index
-		Array.Swap(i, RandomIndex);
-	}
-}
+DEFINE_LOG_CATEGORY_STATIC(LogCloth, Log, All);
 
+static TAutoConsoleVariable<bool> CVarClothDebugDrawColliders(
+	TEXT("cloth.DebugDrawColliders"),
+	false,
+	TEXT("Draw the colliders each cloth collides with, and its particles while any are near."));
 
 // Sets default values
 ACloth::ACloth()
@@ -33,6 +27,11 @@ ACloth::ACloth()
 	ClothMesh = CreateDefaultSubobject<UProceduralMeshComponent>("ProceduralMesh");
 	ClothMesh->SetupAttachment(RootComponent);
 
+	// Full detail up close, then half and quarter resolution with fewer iterations and a slower rate
+	LODs.Add({ 0.25f, 1, 0, 1 });
+	LODs.Add({ 0.08f, 2, 3, 1 });
+	LODs.Add({ 0.0f, 4, 2, 2 });
+
 
 
 
@@ -45,22 +44,45 @@ void ACloth::BeginPlay()
 
 	ClothMesh->SetMaterial(0, ClothMaterial);
 
-	CreateParticles();
-	CreateConstraints();
+	ApplySolverSettings();
+	Solver.Build();
+	PublishInitialState();
 
-	
+	GenerateMesh();
+	ConstrictCloth(ClothConstrictPercentage);
+	CaptureResetSnapshot();
+
+	TimeAccumulator = 0.0f;
 
+	// The subsystem steps every registered cloth together, so this actor no longer needs its own tick
+	if (UClothSubsystem* ClothSubsystem = UWorld::GetSubsystem<UClothSubsystem>(GetWorld()))
+	{
+		if (ClothSubsystem->RegisterCloth(this))
+		{
+			SetActorTickEnabled(false);
+		}
+	}
+}
 
+void ACloth::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	WaitForSimulation();
 
-	GenerateMesh();
-	ConstrictCloth(ClothConstrictPercentage);
+	if (UClothSubsystem* ClothSubsystem = UWorld::GetSubsystem<UClothSubsystem>(GetWorld()))
+	{
+		ClothSubsystem->UnregisterCloth(this);
+	}
 
+	StopRecording();
+	StopPlayback();
 
-	GetWorldTimerManager().SetTimer(UpdateTimer, this, &ACloth::Update, TimeStep, true);
+	Super::EndPlay(EndPlayReason);
 }
 
 void ACloth::Destroyed()
 {
+	StopRecording();
+	StopPlayback();
 	CleanUp();
 
 	Super::Destroyed();
@@ -68,120 +90,193 @@ void ACloth::Destroyed()
 
 void ACloth::CleanUp()
 {
-	for (int Vert = 0; Vert < Particles.Num(); Vert++)
+	WaitForSimulation();
+
+	Solver.Empty();
+	Solver.Inputs.WindField.Reset();
+	RenderStates[0].Empty();
+	RenderStates[1].Empty();
+	PreviousRenderPositions.Empty();
+	HasPendingRenderState = false;
+
+	// Force the next GenerateMesh to rebuild the index buffer
+	MeshTopologyVersion = INDEX_NONE;
+	ClothUVs.Reset();
+}
+
+void ACloth::ResetCloth()
+{
+	WaitForSimulation();
+
+	// A recording only holds changes from the cloth it started on, so it can't follow a reset
+	if (Recorder.IsValid())
 	{
-		for (int Horz = 0; Horz < Particles[Vert].Num(); Horz++)
-		{
-			delete Particles[Vert][Horz];
-		}
+		UE_LOG(LogCloth, Warning, TEXT("%s was reset while recording, the recording stops here"), *GetName());
+		StopRecording();
 	}
 
-	for (auto iter : Constraints)
+	// Nothing to restore, or the cloth would be built differently now
+	if (!Solver.HasSnapshot() || SnapshotSettingsHash != GetBuildSettingsHash())
 	{
-		delete iter;
+		CleanUp();
+
+		ApplySolverSettings();
+		Solver.Build();
+		ConstrictCloth(ClothConstrictPercentage);
+		CaptureResetSnapshot();
+		PublishInitialState();
+		return;
 	}
 
-	Particles.Empty();
-	Constraints.Empty();
+	Solver.RestoreSnapshot();
+	CurrentConstriction = ClothConstrictPercentage;
+
+	TimeAccumulator = 0.0f;
+	PublishInitialState();
 }
 
-void ACloth::ResetCloth()
+void ACloth::CaptureResetSnapshot()
 {
-	CleanUp();
+	Solver.CaptureSnapshot();
+	SnapshotSettingsHash = GetBuildSettingsHash();
+}
 
-	CreateParticles();
-	CreateConstraints();
-	ConstrictCloth(ClothConstrictPercentage);
+uint32 ACloth::GetBuildSettingsHash() const
+{
+	uint32 Hash = GetTypeHash(ClothWidth);
+	Hash = HashCombine(Hash, GetTypeHash(ClothHeight));
+	Hash = HashCombine(Hash, GetTypeHash(NumHorzParticles));
+	Hash = HashCombine(Hash, GetTypeHash(NumVertParticles));
+	Hash = HashCombine(Hash, GetTypeHash(ClothConstrictPercentage));
+	Hash = HashCombine(Hash, GetTypeHash(AmountOfPins));
+	Hash = HashCombine(Hash, GetTypeHash(GetLODGridSize()));
+	Hash = HashCombine(Hash, GetTypeHash(Seed));
+	return Hash;
 }
 
 void ACloth::ConstrictCloth(float _constrictedAmount)
 {
-	// Calculate constricted dimensions
-	float ConstrictedWidth = ClothWidth * _constrictedAmount;
-	float ConstrictedDist = ConstrictedWidth / (NumHorzParticles - 1);
+	WaitForSimulation();
+
+	CurrentConstriction = _constrictedAmount;
+	Solver.Constrict(_constrictedAmount);
+}
 
-	// Determine the starting position (centered around X=0)
-	FVector StartPos(0);
-	StartPos.X = -ConstrictedWidth / 2.0f;  // Start at the left-most constricted point
-	StartPos.Z = ClothHeight / 2.0f;
 
-	// Iterate through horizontal particles
-	for (int Horz = 0; Horz < NumHorzParticles; Horz++)
+FString ACloth::GetRecordingPath(const FString& _fileName) const
+{
+	FString Path = _fileName;
+	if (FPaths::GetExtension(Path).IsEmpty())
 	{
-		ClothParticle* Particle = Particles[0][Horz];
+		Path += TEXT(".clothrec");
+	}
+
+	if (FPaths::IsRelative(Path))
+	{
+		Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ClothRecordings"), Path);
+	}
+	return Path;
+}
 
-		// Calculate new position for this particle
-		FVector ParticlePos = FVector(StartPos.X + Horz * ConstrictedDist, StartPos.Y, StartPos.Z);
+bool ACloth::StartRecording(const FString& _fileName)
+{
+	WaitForSimulation();
+	StopPlayback();
 
-		// Only adjust pinned particles
-		if (Particle->GetPinned())
-		{
-			Particle->SetPosition(ParticlePos); // Set the calculated position directly
-		}
+	// Constraint state is recorded as changes from a fresh cloth, so start from one at full detail
+	CurrentLOD = 0;
+	ResetCloth();
+
+	Recorder = MakeUnique<ClothRecordingWriter>();
+	if (!Recorder->Open(GetRecordingPath(_fileName), Solver.Particles.GetNumHorz(), Solver.Particles.GetNumVert(), Solver.Constraints.Num(), TimeStep))
+	{
+		Recorder.Reset();
+		return false;
 	}
+	return true;
 }
 
+void ACloth::StopRecording()
+{
+	if (Recorder.IsValid())
+	{
+		WaitForSimulation();
+		Recorder->Close();
+		Recorder.Reset();
+	}
+}
 
-void ACloth::AddRandomBurn()
+bool ACloth::StartPlayback(const FString& _fileName, bool _loop)
 {
-	// Randomly select a particle and apply a random burn force
-	int VertIndex = FMath::RandRange(0, Particles.Num() - 1);
-	int HorzIndex = FMath::RandRange(0, Particles[VertIndex].Num() - 1);
-	ClothParticle* Particle = Particles[VertIndex][HorzIndex];
+	WaitForSimulation();
+	StopRecording();
 
-	Particle->AddBurn(0.25f);
+	// The recording starts from a fresh cloth at full detail
+	CurrentLOD = 0;
+	ResetCloth();
+
+	Player = MakeUnique<ClothRecordingReader>();
+	if (!Player->Open(GetRecordingPath(_fileName)))
+	{
+		Player.Reset();
+		return false;
+	}
+
+	const ClothRecordingFormat::FHeader& Header = Player->GetHeader();
+	if (Header.NumHorz != Solver.Particles.GetNumHorz() || Header.NumVert != Solver.Particles.GetNumVert() || Header.NumConstraints != Solver.Constraints.Num())
+	{
+		UE_LOG(LogCloth, Warning, TEXT("%s was recorded from a %dx%d cloth with %d constraints, this one is %dx%d with %d"),
+			*_fileName, Header.NumHorz, Header.NumVert, Header.NumConstraints,
+			Solver.Particles.GetNumHorz(), Solver.Particles.GetNumVert(), Solver.Constraints.Num());
+		Player.Reset();
+		return false;
+	}
+
+	PlaybackFrame = 0;
+	LoopPlayback = _loop;
+	return true;
 }
 
-void ACloth::PropagateBurn()
+void ACloth::StopPlayback()
 {
-	// Iterate through all particles to check burn status
-	for (int Vert = 0; Vert < Particles.Num(); Vert++)
+	Player.Reset();
+}
+
+void ACloth::StepPlayback()
+{
+	if (PlaybackFrame >= Player->NumFrames())
 	{
-		for (int Horz = 0; Horz < Particles[Vert].Num(); Horz++)
+		if (!LoopPlayback || Player->NumFrames() == 0)
 		{
-			ClothParticle* Particle = Particles[Vert][Horz];
-
-			// Check if the current particle is burning
-			if (Particle->GetBurnAmount() >= 0.9f && (FMath::FRandRange(0.0f, 1.0f) <= 0.05f)) // Near Max Burn
-			{
-				// Find valid neighboring particles
-				TArray<ClothParticle*> ValidNeighbors;
-
-				for (int dVert = -1; dVert <= 1; dVert++)
-				{
-					for (int dHorz = -1; dHorz <= 1; dHorz++)
-					{
-						// Skip the particle itself
-						if (dVert == 0 && dHorz == 0) continue;
-
-						int NeighborVert = Vert + dVert;
-						int NeighborHorz = Horz + dHorz;
-
-						// Ensure indices are within bounds
-						if (NeighborVert >= 0 && NeighborVert < Particles.Num() &&
-							NeighborHorz >= 0 && NeighborHorz < Particles[NeighborVert].Num())
-						{
-							ClothParticle* Neighbor = Particles[NeighborVert][NeighborHorz];
-
-							// Check if neighbor is unburnt or just starting to burn
-							if (Neighbor && Neighbor->GetBurnAmount() <= 0.1f) // Unburnt threshold
-							{
-								ValidNeighbors.Add(Neighbor);
-							}
-						}
-					}
-				}
-
-				// Propagate to one random valid neighbor
-				if (ValidNeighbors.Num() > 0)
-				{
-					int RandomIndex = FMath::RandRange(0, ValidNeighbors.Num() - 1);
-					ClothParticle* SelectedNeighbor = ValidNeighbors[RandomIndex];
-					SelectedNeighbor->AddBurn(0.5f); // Start burning
-				}
-			}
+			StopPlayback();
+			return;
 		}
+
+		// Broken constraints can't be mended by a delta, start over from the fresh cloth
+		ResetCloth();
+		PlaybackFrame = 0;
 	}
+
+	if (!Player->ApplyFrame(PlaybackFrame++, Solver.Particles, Solver.Constraints))
+	{
+		StopPlayback();
+		return;
+	}
+
+	Solver.Surface.UpdateCells(Solver.Constraints);
+	Solver.Surface.Compute(Solver.Particles);
+	PublishRenderState();
+	PresentRenderState();
+}
+
+void ACloth::AddRandomBurn()
+{
+	WaitForSimulation();
+
+	// Randomly select a particle and apply a random burn force
+	int Index = FMath::RandRange(0, Solver.Particles.Num() - 1);
+
+	Solver.BurnFront.Ignite(Solver.Particles, Index, 0.25f);
 }
 
 
@@ -189,9 +284,14 @@ void ACloth::PropagateBurn()
 
 void ACloth::DeleteRandomConstraint()
 {
-	int iRandom = FMath::RandRange(0, Constraints.Num() - 1);
+	WaitForSimulation();
+
+	int iRandom = FMath::RandRange(0, Solver.Constraints.Num() - 1);
 
-	Constraints[iRandom]->DisableConstraint();
+	if (Solver.Constraints.GetEnabled(iRandom))
+	{
+		Solver.Constraints.DisableConstraint(iRandom);
+	}
 }
 
 // Called every frame
@@ -199,305 +299,497 @@ void ACloth::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	AdvanceSimulation(DeltaTime);
 	GenerateMesh();
 }
 
-// This is tied to a fixed framerate (60fps)
-void ACloth::Update()
+void ACloth::AdvanceSimulation(float _deltaTime)
 {
-	RandomisedConstraints = Constraints;
-	float iterationTimeStep = TimeStep / (float)UpdateSteps;
-	float DivStep = 1.0f / (float)UpdateSteps;
+	UpdateLOD();
 
-	
-	
-	// Call Update on all particles
-	for (int Vert = 0; Vert < Particles.Num(); Vert++)
+	const int Steps = ConsumeSteps(_deltaTime);
+	for (int Step = 0; Step < Steps; Step++)
 	{
-		for (int Horz = 0; Horz < Particles[Vert].Num(); Horz++)
-		{
-			ClothParticle* Particle = Particles[Vert][Horz];
-			float Mass = 1.0f;
+		Update();
+	}
+}
 
-			// Adding Acceleration
-			FVector gravity = { 0, 0, -981.0f * Mass * TimeStep};
-			CalculateWindVector();
-			FVector cachedWindVector = WindVector;
+int ACloth::ConsumeSteps(float _deltaTime)
+{
+	// Frozen cloth picks up where it left off, not with the time it missed
+	if (IsFrozen)
+	{
+		TimeAccumulator = 0.0f;
+		return 0;
+	}
 
-			int index = Horz + Particles[Vert].Num() * Vert;
-			float dotProduct = FVector::DotProduct(ClothNormals[index], cachedWindVector);
-			float windForceMultiplier = (abs(dotProduct) <= 0.1) ? 0.1 : abs(dotProduct);
-			cachedWindVector *= windForceMultiplier * Mass * TimeStep * TimeStep;
+	const float StepTime = GetStepTime();
+	TimeAccumulator += _deltaTime;
 
-			Particle->AddForce(gravity);
-			Particle->AddForce(cachedWindVector);
+	int Steps = 0;
+	while (TimeAccumulator >= StepTime && Steps < MaxCatchUpSteps)
+	{
+		TimeAccumulator -= StepTime;
+		Steps++;
+	}
 
-			// Update
-			Particle->Update(TimeStep);
-		}
+	// Too far behind, drop the time we could not simulate rather than spiralling
+	if (TimeAccumulator >= StepTime)
+	{
+		TimeAccumulator = FMath::Fmod(TimeAccumulator, StepTime);
 	}
+	return Steps;
+}
 
+float ACloth::GetStepTime() const
+{
+	const FClothLOD* LOD = GetCurrentLOD();
+	return LOD != nullptr ? TimeStep * LOD->StepInterval : TimeStep;
+}
 
-	for (int i = 0; i < UpdateSteps; i++)
+const FClothLOD* ACloth::GetCurrentLOD() const
+{
+	return UseSimulationLOD && LODs.IsValidIndex(CurrentLOD) ? &LODs[CurrentLOD] : nullptr;
+}
+
+FIntPoint ACloth::GetLODGridSize() const
+{
+	const FClothLOD* LOD = GetCurrentLOD();
+	const int Divisor = LOD != nullptr ? FMath::Max(LOD->ResolutionDivisor, 1) : 1;
+
+	// Keep both edges, and at least three particles a side so the interwoven constraints still exist
+	return FIntPoint(
+		FMath::Max((NumHorzParticles - 1) / Divisor + 1, FMath::Min(NumHorzParticles, 3)),
+		FMath::Max((NumVertParticles - 1) / Divisor + 1, FMath::Min(NumVertParticles, 3)));
+}
+
+float ACloth::GetScreenSize() const
+{
+	const APlayerCameraManager* Camera = UGameplayStatics::GetPlayerCameraManager(this, 0);
+	if (Camera == nullptr)
 	{
-	
-		for (auto iter : RandomisedConstraints)
+		return 1.0f;
+	}
+
+	const FBoxSphereBounds& Bounds = ClothMesh->Bounds;
+	const float Distance = FVector::Dist(Camera->GetCameraLocation(), Bounds.Origin);
+	const float HalfFOV = FMath::DegreesToRadians(Camera->GetFOVAngle() * 0.5f);
+
+	// Bounds diameter over the full width of the view at that distance
+	const float ViewWidth = 2.0f * Distance * FMath::Tan(HalfFOV);
+	return (2.0f * Bounds.SphereRadius) / FMath::Max(ViewWidth, 1.0f);
+}
+
+void ACloth::UpdateLOD()
+{
+	// Recordings are made and played back at full detail
+	if (!UseSimulationLOD || LODs.Num() == 0 || Recorder.IsValid() || Player.IsValid())
+	{
+		IsFrozen = false;
+		return;
+	}
+
+	const bool Offscreen = !WasRecentlyRendered(OffscreenDelay);
+	IsFrozen = Offscreen && FreezeWhenOffscreen;
+	if (IsFrozen)
+	{
+		return;
+	}
+
+	int NewLOD = LODs.Num() - 1;
+	if (!Offscreen)
+	{
+		const float ScreenSize = GetScreenSize();
+		for (int LOD = 0; LOD < LODs.Num(); LOD++)
 		{
-			if (iter->GetInterwoven() && !SimulateInterwovenConstraints)
+			// Harder to leave the current level than to enter another, so a cloth on a boundary doesn't flip every frame
+			const float Bias = LOD < CurrentLOD ? 1.0f + LODHysteresis : (LOD == CurrentLOD ? 1.0f - LODHysteresis : 1.0f);
+			if (ScreenSize >= LODs[LOD].MinScreenSize * Bias)
 			{
-				continue;
+				NewLOD = LOD;
+				break;
 			}
-			iter->Update(DivStep);
 		}
-		
-		ShuffleArray(RandomisedConstraints);
 	}
 
-	// Fire spread
-	PropagateBurn();
+	if (NewLOD == CurrentLOD)
+	{
+		return;
+	}
 
-	// Check Collisions
-	CheckForCollision();
+	WaitForSimulation();
 
+	const FIntPoint OldGridSize(Solver.Particles.GetNumHorz(), Solver.Particles.GetNumVert());
+	const float OldStepTime = GetStepTime();
+	CurrentLOD = NewLOD;
 
+	// Keep the time into the current step at the same fraction of the new one, so interpolation doesn't jump
+	TimeAccumulator *= GetStepTime() / OldStepTime;
+
+	// A torn or burning cloth keeps its resolution, only the iterations and rate drop
+	const FIntPoint NewGridSize = GetLODGridSize();
+	if (NewGridSize == OldGridSize || !Solver.CanResample())
+	{
+		return;
+	}
+
+	PresentRenderState();
+	Solver.Resample(NewGridSize.X, NewGridSize.Y);
+	Solver.Constrict(CurrentConstriction);
+
+	// The mesh is rebuilt from scratch for the new grid
+	RenderStates[0].Empty();
+	RenderStates[1].Empty();
+	HasPendingRenderState = false;
+	MeshTopologyVersion = INDEX_NONE;
+	ClothUVs.Reset();
+	PublishInitialState();
 }
 
-void ACloth::CalculateWindVector()
+// Advances the simulation by one fixed TimeStep
+void ACloth::Update()
 {
-	WindVector = WindRotation.Vector();
+	CLOTH_SCOPE(Update);
 
-	WindVector.Normalize();
-	
-	float WindStrength = FMath::Lerp(MinWindStrength / 2, MaxWindStrength / 2, FMath::Sin(GetGameTimeSinceCreation() * WindOscillationFrequency) * 0.5f + 0.5f);
-	float WindStrength2 = FMath::Lerp(MinWindStrength / 2, MaxWindStrength / 2, FMath::Sin(GetGameTimeSinceCreation() * WindOscillationFrequency2) * 0.5f + 0.5f);
-
-	TotalWindStrength = WindStrength + WindStrength2;
+	if (!BeginStep(nullptr))
+	{
+		return;
+	}
 
-	WindVector *= TotalWindStrength;
+	if (AsyncSimulation)
+	{
+		SimulationTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]()
+		{
+			StepSimulation();
+			FinishStep();
+		});
+	}
+	else
+	{
+		StepSimulation();
+		FinishStep();
+		PresentRenderState();
+	}
 }
 
-void ACloth::CheckForCollision()
+bool ACloth::BeginStep(const TArray<ClothCollider>* _worldColliders)
 {
-	// Cache the sphere reference once
-	Sphere = Cast<AClothSphere>(UGameplayStatics::GetActorOfClass(GetWorld(), AClothSphere::StaticClass()));
+	// Fence, the previous step has to finish before its result is shown or the next step starts
+	WaitForSimulation();
+	PresentRenderState();
 
-	if (Sphere)
+	if (Player.IsValid())
 	{
-		FVector SpherePosition = Sphere->GetActorLocation();
-		float Radius = Sphere->GetSphereRadius();
+		StepPlayback();
+		return false;
+	}
 
-		// Draw the sphere's collision volume for debugging
-		DrawDebugSphere(GetWorld(), SpherePosition, Radius, 32, FColor::Red, false, 0.1f);
+	// Anything that reads the world happens here on the game thread
+	CLOTH_SCOPE(GatherInputs);
+	CalculateWindVector();
+	GatherWindField();
+	GatherCollisionInputs(_worldColliders);
+	ApplySolverSettings();
+	return true;
+}
+
+void ACloth::FinishStep()
+{
+	if (Recorder.IsValid())
+	{
+		Recorder->WriteFrame(Solver.Particles, Solver.Constraints);
 	}
 
-	// Iterate through all particles
-	for (int Vert = 0; Vert < Particles.Num(); Vert++)
+	// One settled state is enough to bring the interpolation to rest, after that there is nothing new to show
+	const ClothRenderState& LastPublished = RenderStates[HasPendingRenderState ? 1 - ReadRenderState : ReadRenderState];
+	if (Solver.IsAsleep() && LastPublished.Settled)
 	{
-		for (int Horz = 0; Horz < Particles[Vert].Num(); Horz++)
-		{
-			ClothParticle* Particle = Particles[Vert][Horz];
+		return;
+	}
 
-			// Check for ground collision
-			float GroundHeight = 0.0f - ClothMesh->GetComponentLocation().Z;
-			Particle->CheckForGroundCollision(GroundHeight);
+	PublishRenderState();
+}
 
-			// Check for sphere collision
-			if (Sphere)
-			{
-				Particle->CheckForSphereCollision(Sphere, GetActorLocation());
-				// Draw particle positions for debugging
-				DrawDebugPoint(GetWorld(), Particle->GetPosition() + GetActorLocation(), 5.0f, FColor::Blue, false, 0.1f);
-			}
-		}
+void ACloth::WaitForSimulation()
+{
+	if (SimulationTask.IsValid())
+	{
+		CLOTH_SCOPE(Wait);
+		SimulationTask.Wait();
+		SimulationTask = {};
 	}
 }
 
+void ACloth::PublishRenderState()
+{
+	CLOTH_SCOPE(Publish);
+	RenderStates[1 - ReadRenderState].Publish(Solver.Particles, Solver.Surface);
+	RenderStates[1 - ReadRenderState].Settled = Solver.IsAsleep();
+	HasPendingRenderState = true;
+}
 
-
-void ACloth::ReleaseCloth()
+void ACloth::PresentRenderState()
 {
-	for (int Horz = 0; Horz < NumHorzParticles; Horz++)
+	if (HasPendingRenderState)
 	{
-		Particles[0][Horz]->SetPinned(false);
+		// Keep the outgoing positions to interpolate from. Swapped rather than copied, the outgoing state
+		// becomes the one published into next, which overwrites its positions anyway
+		Swap(PreviousRenderPositions, RenderStates[ReadRenderState].Positions);
+		ReadRenderState = 1 - ReadRenderState;
+		HasPendingRenderState = false;
+		MeshSettled = false;
 	}
 }
 
-void ACloth::CreateParticles()
+void ACloth::PublishInitialState()
 {
-	HorzDist = ClothWidth / (NumHorzParticles - 1);
-	VertDist = ClothHeight / (NumVertParticles - 1);
+	Solver.Surface.UpdateCells(Solver.Constraints);
+	Solver.Surface.Compute(Solver.Particles);
+	PublishRenderState();
+	PresentRenderState();
 
-	FVector StartPos(0);
-	StartPos.X = -ClothWidth / 2;
-	StartPos.Y = ClothHeight / 2;
+	// Nothing to interpolate from after a rebuild
+	PreviousRenderPositions.Reset();
+}
 
-	for (int Vert = 0; Vert < NumVertParticles; Vert++)
-	{
-		TArray<ClothParticle*> ParticleRow;
+// Safe to run off the game thread, everything it reads from the world was gathered in Update
+void ACloth::StepSimulation()
+{
+	Solver.Step();
+}
 
-		for (int Horz = 0; Horz < NumHorzParticles; Horz++)
-		{
-			FVector ParticlePos = { StartPos.X + Horz * HorzDist, StartPos.Y, StartPos.Z - Vert * VertDist };
+void ACloth::ApplySolverSettings()
+{
+	static_assert((uint8)EClothSolverMode::XPBD == (uint8)EClothSolverType::XPBD, "EClothSolverMode has to mirror EClothSolverType");
+
+	ClothSolverSettings& Settings = Solver.Settings;
+	Settings.ClothWidth = ClothWidth;
+	Settings.ClothHeight = ClothHeight;
+	// Only read by Build, the grid keeps the resolution it was built or resampled at
+	const FIntPoint GridSize = GetLODGridSize();
+	Settings.NumHorzParticles = GridSize.X;
+	Settings.NumVertParticles = GridSize.Y;
+	Settings.AmountOfPins = AmountOfPins;
+	Settings.HierarchyLevels = HierarchyLevels;
+
+	const FClothLOD* LOD = GetCurrentLOD();
+	const int LODIterations = LOD != nullptr ? LOD->SolverIterations : 0;
+
+	Solver.SetTimeStep(GetStepTime());
+	Settings.UpdateSteps = LODIterations > 0 ? FMath::Min(LODIterations, UpdateSteps) : UpdateSteps;
+	Settings.SolverType = (EClothSolverType)SolverMode;
+	Settings.Seed = Seed;
+	Settings.SimulateInterwovenConstraints = SimulateInterwovenConstraints;
+	Settings.UseTethers = UseTethers;
+	Settings.TetherSlack = TetherSlack;
+	Settings.HierarchicalSolve = HierarchicalSolve;
+	Settings.CoarseIterations = CoarseIterations;
+	Settings.Compliance = Compliance;
+	Settings.SolverTolerance = SolverTolerance;
+	Settings.MaxSolverIterations = LODIterations > 0 ? FMath::Min(LODIterations, MaxSolverIterations) : MaxSolverIterations;
+	Settings.AerodynamicWind = AerodynamicWind;
+	Settings.DragCoefficient = DragCoefficient;
+	Settings.LiftCoefficient = LiftCoefficient;
+	Settings.AirDensity = AirDensity;
+	Settings.SelfCollision = SelfCollision;
+	Settings.SelfCollisionThickness = SelfCollisionThickness;
+	Settings.AllowSleeping = AllowSleeping;
+	Settings.SleepSpeed = SleepSpeed;
+	Settings.WakeWindChange = WakeWindChange;
+}
 
-			ClothParticle* NewParticle = new ClothParticle(ParticlePos);
+void ACloth::CalculateWindVector()
+{
+	WindVector = WindRotation.Vector();
 
-			// Pinning only if top row
-			// Always pin start and end
-			int numInteriorHooks = AmountOfPins - 2;
+	WindVector.Normalize();
+	
+	float WindStrength = FMath::Lerp(MinWindStrength / 2, MaxWindStrength / 2, FMath::Sin(GetGameTimeSinceCreation() * WindOscillationFrequency) * 0.5f + 0.5f);
+	float WindStrength2 = FMath::Lerp(MinWindStrength / 2, MaxWindStrength / 2, FMath::Sin(GetGameTimeSinceCreation() * WindOscillationFrequency2) * 0.5f + 0.5f);
 
-			bool ShouldPin = false;
-			for (int i = 0; i < numInteriorHooks; i++)
-			{
-				float Percentage = 1.0f / (numInteriorHooks + 1);
-				Percentage *= i + 1;
-				Percentage *= NumHorzParticles - 1;
-				int PinnedIndex = FMath::RoundToInt(Percentage);
-
-				if (PinnedIndex == Horz)
-				{
-					ShouldPin = true;
-					break;
-				}
-			}
-			bool Pinned = Vert == 0 && (Horz == 0 || Horz == NumHorzParticles - 1 || ShouldPin);
-			NewParticle->SetPinned(Pinned);
+	TotalWindStrength = WindStrength + WindStrength2;
 
-			ParticleRow.Add(NewParticle);
-		}
+	WindVector *= TotalWindStrength;
+	Solver.Inputs.WindVector = FVector3f(WindVector);
+}
+
+void ACloth::GatherWindField()
+{
+	Solver.Inputs.WindField.Reset();
+	Solver.Inputs.WindFieldOffset = FVector3f(GetActorLocation());
 
-		Particles.Add(ParticleRow);
+	if (UClothWindSubsystem* WindSubsystem = UWorld::GetSubsystem<UClothWindSubsystem>(GetWorld()))
+	{
+		Solver.Inputs.WindField = WindSubsystem->GetWindField();
 	}
 }
 
-void ACloth::CreateConstraints()
+void ACloth::GatherCollisionInputs(const TArray<ClothCollider>* _worldColliders)
 {
-	for (int Vert = 0; Vert < NumVertParticles; Vert++)
-	{
-		for (int Horz = 0; Horz < NumHorzParticles; Horz++)
-		{
-			if (Vert < NumVertParticles - 1)
-			{
-				// Make a vertical constraint
-				class ClothConstraint* NewConstraint = new ClothConstraint(Particles[Vert][Horz], Particles[Vert + 1][Horz]);
+	const ClothRenderState& RenderState = RenderStates[ReadRenderState];
+	const FVector ActorLocation = GetActorLocation();
 
-				Constraints.Add(NewConstraint);
-				
-				Particles[Vert][Horz]->AddConstraint(NewConstraint);
-				Particles[Vert + 1][Horz]->AddConstraint(NewConstraint);
-			}
-			if (Vert < NumVertParticles - 2)
-			{
-				// Make a vertical INTERWOVEN constraint
-				class ClothConstraint* NewConstraint = new ClothConstraint(Particles[Vert][Horz], Particles[Vert + 2][Horz]);
+	Solver.Inputs.GroundHeight = 0.0f - ClothMesh->GetComponentLocation().Z;
 
-				Constraints.Add(NewConstraint);
+	// Last step's bounds, grown by how far the cloth can reasonably move in a step
+	FBox3f ClothBounds(RenderState.Positions.GetData(), RenderState.Positions.Num());
+	ClothBounds = ClothBounds.ExpandBy(ColliderBroadphaseMargin);
 
-				// SET AS INTERWOVEN CONSTRAINT
-				NewConstraint->SetInterwoven(true);
-				Particles[Vert][Horz]->AddConstraint(NewConstraint);
-				Particles[Vert + 2][Horz]->AddConstraint(NewConstraint);
-			}
-			if (Horz < NumHorzParticles - 1)
+	TArray<ClothCollider>& Colliders = Solver.Inputs.Colliders;
+	Colliders.Reset();
+	if (_worldColliders != nullptr)
+	{
+		// Already built once for every cloth this frame, only the move into this cloth's space is left
+		const FVector3f Offset = -FVector3f(ActorLocation);
+		for (const ClothCollider& WorldCollider : *_worldColliders)
+		{
+			ClothCollider Collider = WorldCollider;
+			Collider.Translate(Offset);
+			if (Collider.Bounds.Intersect(ClothBounds))
 			{
-				// Make a vertical constraint
-				ClothConstraint* NewConstraint = new ClothConstraint(Particles[Vert][Horz], Particles[Vert][Horz + 1]);
-				
-				Constraints.Add(NewConstraint);
-				
-				Particles[Vert][Horz]->AddConstraint(NewConstraint);
-				Particles[Vert][Horz + 1]->AddConstraint(NewConstraint);
+				Colliders.Add(Collider);
 			}
-			if (Horz < NumHorzParticles - 2)
-			{
-				// Make a vertical INTERWOVEN constraint
-				ClothConstraint* NewConstraint = new ClothConstraint(Particles[Vert][Horz], Particles[Vert][Horz + 2]);
+		}
+	}
+	else if (UClothColliderSubsystem* ColliderSubsystem = UWorld::GetSubsystem<UClothColliderSubsystem>(GetWorld()))
+	{
+		ColliderSubsystem->GatherColliders(ActorLocation, ClothBounds, Colliders);
+	}
 
-				Constraints.Add(NewConstraint);
+	if (Colliders.Num() > 0 && CVarClothDebugDrawColliders.GetValueOnGameThread())
+	{
+		// Draw the collision volumes for debugging
+		for (const ClothCollider& Collider : Colliders)
+		{
+			const FVector Center = FVector(Collider.Center) + ActorLocation;
+			const FQuat Rotation = FQuat(Collider.Rotation);
 
-				// SET AS INTERWOVEN CONSTRAINT
-				NewConstraint->SetInterwoven(true);
-				Particles[Vert][Horz]->AddConstraint(NewConstraint);
-				Particles[Vert][Horz + 2]->AddConstraint(NewConstraint);
+			switch (Collider.Type)
+			{
+			case EClothColliderType::Sphere:
+				DrawDebugSphere(GetWorld(), Center, Collider.Radius, 32, FColor::Red, false, 0.1f);
+				break;
+			case EClothColliderType::Capsule:
+				DrawDebugCapsule(GetWorld(), Center, Collider.HalfHeight + Collider.Radius, Collider.Radius, Rotation, FColor::Red, false, 0.1f);
+				break;
+			case EClothColliderType::Box:
+				DrawDebugBox(GetWorld(), Center, FVector(Collider.HalfExtents), Rotation, FColor::Red, false, 0.1f);
+				break;
+			default:
+				break;
 			}
 		}
 
+		// Draw particle positions for debugging
+		for (const FVector3f& Position : RenderState.Positions)
+		{
+			DrawDebugPoint(GetWorld(), FVector(Position) + ActorLocation, 5.0f, FColor::Blue, false, 0.1f);
+		}
 	}
+}
 
-	RandomisedConstraints = Constraints;
+void ACloth::ReleaseCloth()
+{
+	WaitForSimulation();
+
+	Solver.Release();
 }
 
 void ACloth::GenerateMesh()
 {
-	ClothVertices.Reset();
-	ClothTriangles.Reset();
-	ClothNormals.Reset();
-	ClothUVs.Reset();
-	ClothColors.Reset();
+	CLOTH_SCOPE(GenerateMesh);
+
+	// Sleeping cloth, the mesh already matches it. A partly asleep cloth is uploaded whole,
+	// the procedural mesh can only stream a section's vertex buffers in full
+	if (MeshSettled)
+	{
+		return;
+	}
 
+	const ClothRenderState& RenderState = RenderStates[ReadRenderState];
+	const int NumVertices = RenderState.NumVertices();
 
-	for (int Vert = 0; Vert < NumVertParticles; Vert++)
+	// Only rebuild the index buffer when a constraint has broken since the last build
+	bool TopologyChanged = MeshTopologyVersion != RenderState.TopologyVersion;
+	if (TopologyChanged)
 	{
-		for (int Horz = 0; Horz < NumHorzParticles; Horz++)
-		{
-			ClothVertices.Add(Particles[Vert][Horz]->GetPosition());
+		BuildMeshTopology();
+	}
 
+	ClothVertices.SetNumUninitialized(NumVertices, false);
+	ClothColors.SetNumUninitialized(NumVertices, false);
+	ClothNormals.SetNumUninitialized(NumVertices, false);
+	ClothTangents.SetNum(NumVertices, false);
 
-			// For vertex colour we will use burn amount
-			FLinearColor ParticleColor(Particles[Vert][Horz]->GetBurnAmount(), 0.0f, 0.0f, 0.0f);
-			ClothColors.Add(ParticleColor);
+	// Blend between the last two steps by how far we are into the next one
+	const bool Interpolate = InterpolateRender && PreviousRenderPositions.Num() == RenderState.Num();
+	const float Alpha = FMath::Clamp(TimeAccumulator / GetStepTime(), 0.0f, 1.0f);
 
-			ClothUVs.Add(FVector2D(float(Horz) / (NumHorzParticles - 1), float(Vert) / (NumVertParticles - 1)));
-		}
+	for (int Index = 0; Index < NumVertices; Index++)
+	{
+		// Split vertices follow the particle they were split from
+		const int Particle = RenderState.VertexParticles[Index];
+
+		ClothVertices[Index] = Interpolate ?
+			FVector(FMath::Lerp(PreviousRenderPositions[Particle], RenderState.Positions[Particle], Alpha)) :
+			FVector(RenderState.Positions[Particle]);
+
+		// For vertex colour we will use burn amount
+		ClothColors[Index] = FLinearColor(RenderState.BurnAmounts[Particle], 0.0f, 0.0f, 0.0f);
+
+		ClothNormals[Index] = FVector(RenderState.Normals[Index]);
+		ClothTangents[Index] = FProcMeshTangent(FVector(RenderState.Tangents[Index]), false);
 	}
 
-	for (int Vert = 0; Vert < NumVertParticles - 1; Vert++)
+	CLOTH_SCOPE(Upload);
+
+	uint32 BytesUploaded = ClothVertices.Num() * ClothVertices.GetTypeSize() + ClothNormals.Num() * ClothNormals.GetTypeSize() +
+		ClothUVs.Num() * ClothUVs.GetTypeSize() + ClothColors.Num() * ClothColors.GetTypeSize() + ClothTangents.Num() * ClothTangents.GetTypeSize();
+
+	if (TopologyChanged)
 	{
-		for (int Horz = 0; Horz < NumHorzParticles - 1; Horz++)
-		{
-			TryCreateTriangles(Particles[Vert][Horz], Particles[Vert][Horz + 1],
-				Particles[Vert + 1][Horz], Particles[Vert + 1][Horz + 1], Vert * NumHorzParticles + Horz);
-		}
+		// The procedural mesh can't patch part of an index buffer, so the section is recreated
+		ClothMesh->CreateMeshSection_LinearColor(0, ClothVertices, ClothTriangles, ClothNormals, ClothUVs, ClothColors, ClothTangents, false);
+		BytesUploaded += ClothTriangles.Num() * ClothTriangles.GetTypeSize();
+	}
+	else
+	{
+		// Streams the vertex data into the existing buffers
+		ClothMesh->UpdateMeshSection_LinearColor(0, ClothVertices, ClothNormals, ClothUVs, ClothColors, ClothTangents);
 	}
 
-	TArray <FProcMeshTangent> ClothTangents;
+	INC_DWORD_STAT_BY(STAT_ClothBytesUploaded, BytesUploaded);
 
-	UKismetProceduralMeshLibrary::CalculateTangentsForMesh(ClothVertices, ClothTriangles, ClothUVs, ClothNormals, ClothTangents);
-	
-	ClothMesh->CreateMeshSection_LinearColor(0, ClothVertices, ClothTriangles, ClothNormals, ClothUVs, ClothColors, ClothTangents, false);
+	// Both ends of the interpolation are the same settled state, so this mesh stays valid
+	MeshSettled = RenderState.Settled;
 }
 
-void ACloth::TryCreateTriangles(ClothParticle* _topLeft, ClothParticle* _topRight, ClothParticle* _bottomLeft, ClothParticle* _bottomRight, int _topLeftIndex)
+void ACloth::BuildMeshTopology()
 {
-	int TopLeftIndex = _topLeftIndex;
-	int TopRightIndex = _topLeftIndex + 1;
-	int BottomLeftIndex = _topLeftIndex + NumHorzParticles;
-	int BottomRightIndex = _topLeftIndex + 1 + NumHorzParticles;
+	CLOTH_SCOPE(MeshBuild);
+
+	const ClothRenderState& RenderState = RenderStates[ReadRenderState];
+	const int NumVertices = RenderState.NumVertices();
+
+	// The simulation already patched the cells around each tear, see ClothSurface::UpdateCells
+	ClothTriangles = RenderState.Indices;
+
+	// UVs span the grid the solver is running, which the LOD may have decimated
+	const int GridHorz = Solver.Particles.GetNumHorz();
+	const int GridVert = Solver.Particles.GetNumVert();
 
-	if (_topLeft->SharesConstraint(_topRight) && _topLeft->SharesConstraint(_bottomLeft))
+	// Vertices are only ever appended, so the existing UVs stay valid
+	if (ClothUVs.Num() > NumVertices)
 	{
-		ClothTriangles.Add(TopLeftIndex);
-		ClothTriangles.Add(TopRightIndex);
-		ClothTriangles.Add(BottomLeftIndex);
-	
-		if (_bottomRight->SharesConstraint(_topRight) && _bottomRight->SharesConstraint(_bottomLeft))
-		{
-			ClothTriangles.Add(TopRightIndex);
-			ClothTriangles.Add(BottomRightIndex);
-			ClothTriangles.Add(BottomLeftIndex);
-		}
+		ClothUVs.Reset();
 	}
-	else if (_bottomLeft->SharesConstraint(_topLeft) && _bottomLeft->SharesConstraint(_bottomRight))
+	for (int Index = ClothUVs.Num(); Index < NumVertices; Index++)
 	{
-		ClothTriangles.Add(BottomLeftIndex);
-		ClothTriangles.Add(TopLeftIndex);
-		ClothTriangles.Add(BottomRightIndex);
-	
-		if (_topRight->SharesConstraint(_bottomRight) && _topRight->SharesConstraint(_topLeft))
-		{
-			ClothTriangles.Add(TopRightIndex);
-			ClothTriangles.Add(BottomRightIndex);
-			ClothTriangles.Add(TopLeftIndex);
-		}
+		const int Particle = RenderState.VertexParticles[Index];
+		const int Horz = Particle % GridHorz;
+		const int Vert = Particle / GridHorz;
+		ClothUVs.Add(FVector2D(float(Horz) / (GridHorz - 1), float(Vert) / (GridVert - 1)));
 	}
 
-}
\ No newline at end of file
+	MeshTopologyVersion = RenderState.TopologyVersion;
+}
@@ -4,17 +4,56 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "ProceduralMeshComponent.h"
+#include "ClothSolver.h"
+#include "ClothRenderState.h"
+#include "ClothWindSubsystem.h"
+#include "ClothRecording.h"
+#include "Tasks/Task.h"
 #include "Cloth.generated.h"
 
-class ClothParticle;
-class ClothConstraint;
 class UProceduralMeshComponent;
 
+// Mirrors EClothSolverType for the editor
+UENUM(BlueprintType)
+enum class EClothSolverMode : uint8
+{
+    // Serial Gauss-Seidel, sweeping the grid in a different fixed order every substep
+    Shuffled,
+    // Graph coloured constraint batches, each solved with ParallelFor
+    ParallelBatches,
+    // Compliance based batches, iterating until the residual drops below a tolerance
+    XPBD,
+};
+
+// One simulation level of detail, picked by how much of the screen the cloth covers
+USTRUCT(BlueprintType)
+struct FClothLOD
+{
+    GENERATED_BODY()
+
+    // Used while the cloth's bounds cover at least this fraction of the view
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LOD)
+    float MinScreenSize = 0.0f;
+    // Keep every Nth particle along each side of the grid
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LOD, meta = (ClampMin = "1"))
+    int32 ResolutionDivisor = 1;
+    // Substeps, or the most XPBD iterations, 0 uses the cloth's own
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LOD, meta = (ClampMin = "0"))
+    int32 SolverIterations = 0;
+    // Each simulation step covers this many TimeSteps
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LOD, meta = (ClampMin = "1"))
+    int32 StepInterval = 1;
+};
+
 UCLASS()
 class CLOTHSIMULATION_API ACloth : public AActor
 {
     GENERATED_BODY()
 
+    // Drives the registered cloths' steps in place of their own tick
+    friend class UClothSubsystem;
+
 public:
     // Sets default values for this actor's properties
     ACloth();
@@ -25,22 +64,60 @@ public:
 protected:
     // Called when the game starts or when spawned
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     virtual void Destroyed() override;
 
-    void CreateParticles();
-    void CreateConstraints();
-
-    void GenerateMesh();
+    // Copy the properties into the solver, before building it and before every step
+    void ApplySolverSettings();
 
-    void TryCreateTriangles(ClothParticle* _topLeft, ClothParticle* _topRight,
-        ClothParticle* _bottomLeft, ClothParticle* _bottomRight,
-        int _topLeftIndex);
+    // Remember the freshly built state so ResetCloth can restore it
+    void CaptureResetSnapshot();
+    // Hash of the properties the built cloth depends on, a reset rebuilds if they changed
+    uint32 GetBuildSettingsHash() const;
 
+    // Stream the per frame vertex data, rebuilding the index buffer only if the topology changed
+    void GenerateMesh();
+    // Take the index buffer from the render state and add UVs for any new split vertices
+    void BuildMeshTopology();
+
+    // Run as many fixed steps as the frame time allows
+    void AdvanceSimulation(float _deltaTime);
+    // Add the frame time to the accumulator and take out the fixed steps it now holds
+    int ConsumeSteps(float _deltaTime);
+    // Fixed step of the current LOD
+    float GetStepTime() const;
+
+    // Pick the LOD from the cloth's screen size and visibility, resampling the grid if its resolution changed
+    void UpdateLOD();
+    // Fraction of the view the cloth's bounds cover, from the first player's camera
+    float GetScreenSize() const;
+    const FClothLOD* GetCurrentLOD() const;
+    // Particles along each side at the current LOD
+    FIntPoint GetLODGridSize() const;
+    // Gathers world inputs and runs or launches one simulation step
 	void Update();
+    // Game thread half of a step: present the last one and gather the world inputs.
+    // Returns false if a recording is being played back instead
+    bool BeginStep(const TArray<ClothCollider>* _worldColliders);
+    // One simulation step, only touches the cloth's own state
+    void StepSimulation();
+    // Record and publish a finished step, from whichever thread ran it
+    void FinishStep();
+
+    // Block until the in flight simulation step, if any, has finished
+    void WaitForSimulation();
+    // Copy the simulation output into the render state the game thread is not reading
+    void PublishRenderState();
+    // Make the last published render state the one the mesh is built from
+    void PresentRenderState();
+    void PublishInitialState();
 
     void CalculateWindVector();
+    // Take a reference to the world's shared wind field for the next step
+    void GatherWindField();
 
-	void CheckForCollision();
+    // Read the ground height and nearby colliders from the world, or from colliders already gathered in world space
+    void GatherCollisionInputs(const TArray<ClothCollider>* _worldColliders);
 
     // Drop the cloth
     UFUNCTION(BlueprintCallable, Category = "Cloth | Functions")
@@ -54,6 +131,21 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Cloth | Functions")
     void ConstrictCloth(float _constrictedAmount);
 
+    // Stream every simulation step to a file, relative paths go under Saved/ClothRecordings
+    UFUNCTION(BlueprintCallable, Category = "Cloth | Recording")
+    bool StartRecording(const FString& _fileName);
+    UFUNCTION(BlueprintCallable, Category = "Cloth | Recording")
+    void StopRecording();
+    // Reset the cloth and play a recording back in place of the simulation
+    UFUNCTION(BlueprintCallable, Category = "Cloth | Recording")
+    bool StartPlayback(const FString& _fileName, bool _loop);
+    UFUNCTION(BlueprintCallable, Category = "Cloth | Recording")
+    void StopPlayback();
+
+    // Show the next recorded frame instead of simulating a step
+    void StepPlayback();
+    FString GetRecordingPath(const FString& _fileName) const;
+
     UPROPERTY(EditDefaultsOnly, Category = Mesh)
     UProceduralMeshComponent* ClothMesh = nullptr;
 
@@ -66,13 +158,26 @@ protected:
     TArray<FVector> ClothNormals;
     TArray <FVector2D> ClothUVs;
     TArray <FLinearColor> ClothColors;
+    TArray <FProcMeshTangent> ClothTangents;
+
+    // Constraint topology version the index buffer was built from
+    int32 MeshTopologyVersion = INDEX_NONE;
+
+    // Double buffered simulation output, the mesh reads RenderStates[ReadRenderState]
+    ClothRenderState RenderStates[2];
+    int ReadRenderState = 0;
+    // Positions of the step before RenderStates[ReadRenderState], for interpolation
+    TArray<FVector3f> PreviousRenderPositions;
+    bool HasPendingRenderState = false;
+    // The mesh shows a settled render state, so it won't change until the cloth wakes
+    bool MeshSettled = false;
 
-    // The Grid of Particles
-    TArray<TArray<ClothParticle*>> Particles;
+    // The simulation step running on a worker when AsyncSimulation is on
+    UE::Tasks::FTask SimulationTask;
 
-    // The list of all constraints
-    TArray<ClothConstraint*> Constraints;
-	TArray<ClothConstraint*> RandomisedConstraints;
+    // Particles, constraints and everything that steps them, fed the world inputs gathered in Update
+    ClothSolver Solver;
+    uint32 SnapshotSettingsHash = 0;
 
 
     // Cloth Properties
@@ -91,9 +196,6 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Cloth)
     bool SimulateInterwovenConstraints = true;
 
-    float HorzDist;    // cloth width / NumHorzParticles
-    float VertDist;    // cloth height / NumVertParticles
-
 
     // Simulation properties
     UPROPERTY(EditDefaultsOnly, Category = Simulation)
@@ -110,21 +212,118 @@ protected:
     float MaxWindStrength = 800.0f;
     UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Simulation)
     FRotator WindRotation = { 0, 0, 0 };
+    // Drag and lift per triangle from the velocity relative to the wind, instead of a push along the normals
+    UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Simulation)
+    bool AerodynamicWind = false;
+    UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Simulation, meta = (EditCondition = "AerodynamicWind"))
+    float DragCoefficient = 1.0f;
+    UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Simulation, meta = (EditCondition = "AerodynamicWind"))
+    float LiftCoefficient = 0.5f;
+    UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Simulation, meta = (EditCondition = "AerodynamicWind"))
+    float AirDensity = 0.0002f;
     UPROPERTY(EditDefaultsOnly, Category = Simulation)
     int UpdateSteps = 5;
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    EClothSolverMode SolverMode = EClothSolverMode::Shuffled;
+    // Picks the constraint orderings and how fire spreads, the same seed gives the same simulation
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    int32 Seed = 1234;
+    // Tether every particle to its nearest pin so stretch doesn't need many iterations to settle
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    bool UseTethers = true;
+    // Fraction past the rest distance a tether allows before pulling
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "UseTethers"))
+    float TetherSlack = 0.02f;
 
-    FTimerHandle UpdateTimer;
+    // Solve decimated copies of the grid, coarsest first, before the full resolution solve
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    bool HierarchicalSolve = false;
+    // Most coarse levels, each halving the resolution
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "HierarchicalSolve"))
+    int HierarchyLevels = 4;
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "HierarchicalSolve"))
+    int CoarseIterations = 4;
+
+    // XPBD inverse stiffness, stretch no longer depends on the iteration count
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "SolverMode == EClothSolverMode::XPBD"))
+    float Compliance = 0.00001f;
+    // XPBD stops iterating once the largest residual strain is below this
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "SolverMode == EClothSolverMode::XPBD"))
+    float SolverTolerance = 0.001f;
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "SolverMode == EClothSolverMode::XPBD"))
+    int MaxSolverIterations = 20;
+
+    // Run the simulation step on a worker while the game thread renders the previous one.
+    // Only for a cloth ticking itself, with cloth.BatchedSimulation on cloth.BatchAsync decides for every cloth
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    bool AsyncSimulation = false;
+
+    // Fixed simulation step, rendering interpolates between steps
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
     float TimeStep = 0.016f; // 60fps
+    // Most steps a single frame may run to catch up before time is dropped
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    int MaxCatchUpSteps = 4;
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    bool InterpolateRender = true;
+
+    // Frame time not yet simulated
+    float TimeAccumulator = 0.0f;
+
+    // Cut resolution, iterations and step rate as the cloth gets smaller on screen
+    UPROPERTY(EditDefaultsOnly, Category = LOD)
+    bool UseSimulationLOD = true;
+    // Finest first, the first level whose MinScreenSize the cloth covers is used
+    UPROPERTY(EditDefaultsOnly, Category = LOD, meta = (EditCondition = "UseSimulationLOD"))
+    TArray<FClothLOD> LODs;
+    // Fraction past a level's screen size the cloth has to move before the level changes
+    UPROPERTY(EditDefaultsOnly, Category = LOD, meta = (EditCondition = "UseSimulationLOD"))
+    float LODHysteresis = 0.1f;
+    // Stop simulating when not rendered, otherwise drop to the coarsest level
+    UPROPERTY(EditDefaultsOnly, Category = LOD, meta = (EditCondition = "UseSimulationLOD"))
+    bool FreezeWhenOffscreen = false;
+    // Seconds without being rendered before the cloth counts as off screen
+    UPROPERTY(EditDefaultsOnly, Category = LOD, meta = (EditCondition = "UseSimulationLOD"))
+    float OffscreenDelay = 0.5f;
+
+    UPROPERTY(VisibleInstanceOnly, Category = LOD)
+    int32 CurrentLOD = 0;
+    bool IsFrozen = false;
+
+    // Constriction the pins were last moved to, restored after the grid is resampled
+    float CurrentConstriction = 1.0f;
 
     UFUNCTION(BlueprintCallable)
     void AddRandomBurn();
 
-    void PropagateBurn();
-
     void DeleteRandomConstraint();
 
-    UPROPERTY()
-    class AClothSphere* Sphere = nullptr;
+    // How far past last step's bounds to look for colliders
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    float ColliderBroadphaseMargin = 50.0f;
+
+    // Push apart particles that are not joined by a constraint, rebuilt every substep
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    bool SelfCollision = false;
+    // Closest two unconnected particles may get, in cm
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "SelfCollision"))
+    float SelfCollisionThickness = 3.0f;
+
+    // Let regions that have come to rest stop simulating until something disturbs them
+    UPROPERTY(EditDefaultsOnly, Category = Simulation)
+    bool AllowSleeping = true;
+    // Fastest a particle may move, in cm/s, for its region to count as at rest
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "AllowSleeping"))
+    float SleepSpeed = 1.0f;
+    // Change in wind strength at a sleeping region that wakes it
+    UPROPERTY(EditDefaultsOnly, Category = Simulation, meta = (EditCondition = "AllowSleeping"))
+    float WakeWindChange = 50.0f;
+
+    // Set while recording or playing back
+    TUniquePtr<ClothRecordingWriter> Recorder;
+    TUniquePtr<ClothRecordingReader> Player;
+    int32 PlaybackFrame = 0;
+    bool LoopPlayback = false;
 
 public:
     // Called every frame
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothColliderComponent.h"
+#include "ClothColliderSubsystem.h"
+
+ClothCollider UClothColliderComponent::MakeCollider(const FVector& _clothOrigin) const
+{
+    const FTransform& Transform = GetComponentTransform();
+    const FVector Scale = Transform.GetScale3D().GetAbs();
+
+    ClothCollider Collider;
+    Collider.Center = FVector3f(Transform.GetLocation() - _clothOrigin);
+    Collider.Rotation = FQuat4f(Transform.GetRotation());
+    Collider.Radius = Radius * Scale.GetMax();
+    Collider.HalfHeight = HalfHeight * Scale.Z;
+    Collider.HalfExtents = FVector3f(BoxExtent * Scale);
+
+    switch (Shape)
+    {
+    case EClothColliderShape::Sphere:  Collider.Type = EClothColliderType::Sphere; break;
+    case EClothColliderShape::Capsule: Collider.Type = EClothColliderType::Capsule; break;
+    case EClothColliderShape::Plane:   Collider.Type = EClothColliderType::Plane; break;
+    case EClothColliderShape::Box:     Collider.Type = EClothColliderType::Box; break;
+    }
+
+    Collider.UpdateBounds();
+    return Collider;
+}
+
+void UClothColliderComponent::OnRegister()
+{
+    Super::OnRegister();
+
+    if (UClothColliderSubsystem* Subsystem = UWorld::GetSubsystem<UClothColliderSubsystem>(GetWorld()))
+    {
+        Subsystem->RegisterCollider(this);
+    }
+}
+
+void UClothColliderComponent::OnUnregister()
+{
+    if (UClothColliderSubsystem* Subsystem = UWorld::GetSubsystem<UClothColliderSubsystem>(GetWorld()))
+    {
+        Subsystem->UnregisterCollider(this);
+    }
+
+    Super::OnUnregister();
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "ClothCollision.h"
+#include "ClothColliderComponent.generated.h"
+
+UENUM(BlueprintType)
+enum class EClothColliderShape : uint8
+{
+    Sphere,
+    // Runs along the component's Z axis
+    Capsule,
+    // Faces along the component's Z axis
+    Plane,
+    Box,
+};
+
+/**
+ * A shape every cloth in the world collides with.
+ * Registers itself with UClothColliderSubsystem while it is registered.
+ */
+UCLASS(ClassGroup = (Cloth), meta = (BlueprintSpawnableComponent))
+class CLOTHSIMULATION_API UClothColliderComponent : public USceneComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Build the collider, moved into the space of a cloth at _clothOrigin
+    ClothCollider MakeCollider(const FVector& _clothOrigin) const;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Collision)
+    EClothColliderShape Shape = EClothColliderShape::Sphere;
+    // Sphere and capsule radius
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Collision)
+    float Radius = 50.0f;
+    // Capsule half length, excluding the caps
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Collision)
+    float HalfHeight = 50.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Collision)
+    FVector BoxExtent = { 50.0f, 50.0f, 50.0f };
+
+protected:
+    virtual void OnRegister() override;
+    virtual void OnUnregister() override;
+};
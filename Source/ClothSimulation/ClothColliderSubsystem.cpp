@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothColliderSubsystem.h"
+#include "ClothColliderComponent.h"
+
+void UClothColliderSubsystem::RegisterCollider(UClothColliderComponent* _collider)
+{
+    Colliders.AddUnique(_collider);
+}
+
+void UClothColliderSubsystem::UnregisterCollider(UClothColliderComponent* _collider)
+{
+    Colliders.RemoveSwap(_collider);
+}
+
+void UClothColliderSubsystem::GatherColliders(const FVector& _clothOrigin, const FBox3f& _clothBounds, TArray<ClothCollider>& _outColliders) const
+{
+    _outColliders.Reset();
+
+    for (const UClothColliderComponent* Component : Colliders)
+    {
+        if (Component == nullptr)
+        {
+            continue;
+        }
+
+        ClothCollider Collider = Component->MakeCollider(_clothOrigin);
+        if (Collider.Bounds.Intersect(_clothBounds))
+        {
+            _outColliders.Add(Collider);
+        }
+    }
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClothCollision.h"
+#include "ClothColliderSubsystem.generated.h"
+
+class UClothColliderComponent;
+
+/**
+ * Registry of every cloth collider in the world.
+ * Cloths ask it for the colliders overlapping their bounds once per step
+ * instead of scanning the world's actors.
+ */
+UCLASS()
+class CLOTHSIMULATION_API UClothColliderSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    void RegisterCollider(UClothColliderComponent* _collider);
+    void UnregisterCollider(UClothColliderComponent* _collider);
+
+    // Broadphase, the colliders whose bounds overlap _clothBounds, in the cloth's space
+    void GatherColliders(const FVector& _clothOrigin, const FBox3f& _clothBounds, TArray<ClothCollider>& _outColliders) const;
+
+    int32 NumColliders() const { return Colliders.Num(); }
+
+private:
+    UPROPERTY()
+    TArray<TObjectPtr<UClothColliderComponent>> Colliders;
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothRenderState.h"
+#include "ClothParticleStore.h"
+#include "ClothSurface.h"
+
+void ClothRenderState::Publish(const ClothParticleStore& _particles, const ClothSurface& _surface)
+{
+    Positions = _particles.Positions;
+    Normals = _surface.Normals;
+    Tangents = _surface.Tangents;
+    BurnAmounts = _particles.BurnAmounts;
+
+    // The vertices and indices only change when a constraint breaks
+    if (TopologyVersion != _surface.GetTopologyVersion())
+    {
+        VertexParticles = _surface.GetVertexParticles();
+        Indices = _surface.GetIndices();
+        TopologyVersion = _surface.GetTopologyVersion();
+    }
+}
+
+void ClothRenderState::Empty()
+{
+    Positions.Empty();
+    Normals.Empty();
+    Tangents.Empty();
+    BurnAmounts.Empty();
+    VertexParticles.Empty();
+    Indices.Empty();
+
+    TopologyVersion = INDEX_NONE;
+    Settled = false;
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ClothParticleStore;
+class ClothSurface;
+
+/**
+ * Snapshot of everything the mesh needs from one simulation step.
+ * ACloth keeps two of these so the game thread can build the mesh from one
+ * while the simulation writes the next step into the other.
+ */
+class CLOTHSIMULATION_API ClothRenderState
+{
+public:
+    // Copy the current simulation output into this snapshot
+    void Publish(const ClothParticleStore& _particles, const ClothSurface& _surface);
+    void Empty();
+
+    int32 Num() const { return Positions.Num(); }
+    int32 NumVertices() const { return VertexParticles.Num(); }
+
+    // Indexed by particle
+    TArray<FVector3f> Positions;
+    TArray<float> BurnAmounts;
+
+    // Indexed by render vertex
+    TArray<FVector3f> Normals;
+    TArray<FVector3f> Tangents;
+
+    // Render topology, see ClothSurface
+    TArray<int32> VertexParticles;
+    TArray<int32> Indices;
+
+    // Topology version VertexParticles and Indices were built from
+    int32 TopologyVersion = INDEX_NONE;
+
+    // Published from a step where the whole cloth was asleep, so nothing moved since the state before
+    bool Settled = false;
+};
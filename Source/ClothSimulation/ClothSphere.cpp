@@ -3,6 +3,7 @@
 
 
 #include "ClothSphere.h"
+#include "ClothColliderComponent.h"
 
 // Sets default values
 AClothSphere::AClothSphere()
@@ -21,7 +22,14 @@ float AClothSphere::GetSphereRadius()
 void AClothSphere::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// Created at runtime so the Blueprint's own component hierarchy is left alone
+	Collider = NewObject<UClothColliderComponent>(this, TEXT("ClothCollider"));
+	Collider->Shape = EClothColliderShape::Sphere;
+	Collider->Radius = Radius;
+	Collider->SetUsingAbsoluteScale(true);
+	Collider->SetupAttachment(GetRootComponent());
+	Collider->RegisterComponent();
 }
 
 // Called every frame
@@ -23,6 +23,10 @@ protected:
 
 	float Radius = 50.0f;
 
+	// Registers the sphere with the cloth collider registry
+	UPROPERTY()
+	class UClothColliderComponent* Collider = nullptr;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothSubsystem.h"
+#include "Cloth.h"
+#include "ClothColliderSubsystem.h"
+#include "ClothStats.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarClothBatchedSimulation(
+    TEXT("cloth.BatchedSimulation"),
+    true,
+    TEXT("Step every cloth from UClothSubsystem as one parallel batch instead of each actor ticking itself. Read when a cloth begins play."));
+
+static TAutoConsoleVariable<bool> CVarClothBatchAsync(
+    TEXT("cloth.BatchAsync"),
+    true,
+    TEXT("Run the cloth batch on workers while the frame carries on, showing its result next frame. Replaces each batched cloth's AsyncSimulation."));
+
+void UClothSubsystem::Deinitialize()
+{
+    WaitForBatch();
+    Cloths.Empty();
+
+    Super::Deinitialize();
+}
+
+bool UClothSubsystem::RegisterCloth(ACloth* _cloth)
+{
+    if (!CVarClothBatchedSimulation.GetValueOnGameThread())
+    {
+        return false;
+    }
+
+    WaitForBatch();
+    Cloths.AddUnique(_cloth);
+    return true;
+}
+
+void UClothSubsystem::UnregisterCloth(ACloth* _cloth)
+{
+    WaitForBatch();
+    Cloths.RemoveSwap(_cloth);
+}
+
+void UClothSubsystem::WaitForBatch()
+{
+    if (BatchTask.IsValid())
+    {
+        CLOTH_SCOPE(Wait);
+        BatchTask.Wait();
+        BatchTask = {};
+    }
+}
+
+TStatId UClothSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UClothSubsystem, STATGROUP_Cloth);
+}
+
+void UClothSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    CLOTH_SCOPE(Update);
+
+    // Fence, last frame's batch has to finish before its result is shown or the cloths are touched
+    WaitForBatch();
+
+    if (Cloths.Num() == 0)
+    {
+        return;
+    }
+
+    // Show last frame's steps, including for cloths that have no step to take this frame
+    for (ACloth* Cloth : Cloths)
+    {
+        if (Cloth != nullptr)
+        {
+            Cloth->PresentRenderState();
+        }
+    }
+
+    {
+        CLOTH_SCOPE(GatherInputs);
+
+        // One pass over the colliders for every cloth, each cloth only moves the overlapping ones into its space
+        WorldColliders.Reset();
+        if (UClothColliderSubsystem* ColliderSubsystem = UWorld::GetSubsystem<UClothColliderSubsystem>(GetWorld()))
+        {
+            ColliderSubsystem->GatherColliders(FVector::ZeroVector, FBox3f(FVector3f(-UE_BIG_NUMBER), FVector3f(UE_BIG_NUMBER)), WorldColliders);
+        }
+    }
+
+    Batch.Reset();
+    MaxBatchSteps = 0;
+
+    for (ACloth* Cloth : Cloths)
+    {
+        if (Cloth == nullptr)
+        {
+            continue;
+        }
+
+        Cloth->UpdateLOD();
+        int32 Steps = Cloth->ConsumeSteps(DeltaTime);
+
+        // A recording advances one frame per fixed step, on the game thread, and the cloth simulates again once it ends
+        while (Steps > 0 && Cloth->Player.IsValid())
+        {
+            Cloth->BeginStep(&WorldColliders);
+            Steps--;
+        }
+
+        if (Steps > 0 && Cloth->BeginStep(&WorldColliders))
+        {
+            Batch.Add({ Cloth, Steps });
+            MaxBatchSteps = FMath::Max(MaxBatchSteps, Steps);
+        }
+    }
+
+    // Upload all, every cloth shows the step that finished last frame while this frame's runs
+    const bool Async = CVarClothBatchAsync.GetValueOnGameThread();
+    if (Async)
+    {
+        for (ACloth* Cloth : Cloths)
+        {
+            if (Cloth != nullptr)
+            {
+                Cloth->GenerateMesh();
+            }
+        }
+    }
+
+    if (Batch.Num() == 0)
+    {
+        return;
+    }
+
+    if (Async)
+    {
+        BatchTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]()
+        {
+            RunBatch();
+        });
+
+        // Anything on a cloth that waits for its simulation now waits for the batch
+        for (const FBatchEntry& Entry : Batch)
+        {
+            Entry.Cloth->SimulationTask = BatchTask;
+        }
+    }
+    else
+    {
+        RunBatch();
+
+        for (ACloth* Cloth : Cloths)
+        {
+            if (Cloth != nullptr)
+            {
+                Cloth->PresentRenderState();
+                Cloth->GenerateMesh();
+            }
+        }
+    }
+}
+
+void UClothSubsystem::RunBatch()
+{
+    for (int32 Step = 0; Step < MaxBatchSteps; Step++)
+    {
+        // Each phase runs over every cloth before the next starts, so cloths of a phase share the workers
+        // and small cloths don't wait behind big ones. Within a cloth the phases parallelise further
+        ParallelFor(Batch.Num(), [this, Step](int32 i)
+        {
+            if (Batch[i].Steps > Step)
+            {
+                Batch[i].Cloth->Solver.StepIntegrate();
+            }
+        });
+
+        ParallelFor(Batch.Num(), [this, Step](int32 i)
+        {
+            if (Batch[i].Steps > Step)
+            {
+                Batch[i].Cloth->Solver.StepSolve();
+            }
+        });
+
+        ParallelFor(Batch.Num(), [this, Step](int32 i)
+        {
+            const FBatchEntry& Entry = Batch[i];
+            if (Entry.Steps <= Step)
+            {
+                return;
+            }
+
+            Entry.Cloth->Solver.StepCollide();
+            Entry.Cloth->FinishStep();
+
+            // Catch up steps are shown straight away, the last one is presented after next tick's fence
+            if (Step < Entry.Steps - 1)
+            {
+                Entry.Cloth->PresentRenderState();
+            }
+        });
+    }
+}
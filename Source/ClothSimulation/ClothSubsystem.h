@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClothCollision.h"
+#include "Tasks/Task.h"
+#include "ClothSubsystem.generated.h"
+
+class ACloth;
+
+/**
+ * Steps every cloth in the world as one batch instead of one actor tick each.
+ * Colliders are gathered once per frame for all cloths, then each phase
+ * (integrate, solve, collide) runs across every cloth in parallel before the
+ * next one starts, and the meshes are all uploaded together on the game thread.
+ * The batch runs while the rest of the frame does, and is fenced next tick.
+ * Inputs are gathered once per frame, so a cloth catching up on several steps
+ * runs all of them against the same wind and colliders, where a cloth ticking
+ * itself gathers them again before each step.
+ */
+UCLASS()
+class CLOTHSIMULATION_API UClothSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    virtual void Deinitialize() override;
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    // Returns false if batching is off and the cloth should keep ticking itself
+    bool RegisterCloth(ACloth* _cloth);
+    void UnregisterCloth(ACloth* _cloth);
+
+    // Block until the batch launched last tick has finished
+    void WaitForBatch();
+
+private:
+    struct FBatchEntry
+    {
+        ACloth* Cloth = nullptr;
+        int32 Steps = 0;
+    };
+
+    // Worker side of the batch, every phase of every cloth for each step
+    void RunBatch();
+
+    UPROPERTY()
+    TArray<TObjectPtr<ACloth>> Cloths;
+
+    // Cloths stepping this frame and how many steps each
+    TArray<FBatchEntry> Batch;
+    int32 MaxBatchSteps = 0;
+
+    // Every collider in world space, shared by all cloths this frame
+    TArray<ClothCollider> WorldColliders;
+
+    UE::Tasks::FTask BatchTask;
+};
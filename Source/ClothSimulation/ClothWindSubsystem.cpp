@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClothWindSubsystem.h"
+#include "Async/ParallelFor.h"
+
+void UClothWindSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (!WindField.IsValid() || Settings.TurbulenceSpeed <= 0.0f)
+    {
+        return;
+    }
+
+    Time += DeltaTime;
+    TimeSinceRebuild += DeltaTime;
+
+    if (TimeSinceRebuild >= Settings.UpdateInterval)
+    {
+        TimeSinceRebuild = 0.0f;
+        RebuildField();
+    }
+}
+
+TStatId UClothWindSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UClothWindSubsystem, STATGROUP_Tickables);
+}
+
+void UClothWindSubsystem::SetWindField(const FClothWindFieldSettings& _settings)
+{
+    Settings = _settings;
+    Time = 0.0f;
+    TimeSinceRebuild = 0.0f;
+    RebuildField();
+}
+
+void UClothWindSubsystem::ClearWindField()
+{
+    WindField.Reset();
+}
+
+void UClothWindSubsystem::RebuildField()
+{
+    // Cloths may still be sampling the old field, build into a new one unless nobody else holds it
+    TSharedPtr<ClothWindField, ESPMode::ThreadSafe> Field;
+    if (WindField.IsValid() && WindField.IsUnique())
+    {
+        Field = ConstCastSharedPtr<ClothWindField>(WindField);
+    }
+    else
+    {
+        Field = MakeShared<ClothWindField, ESPMode::ThreadSafe>();
+    }
+
+    const FBox3f Bounds(FVector3f(Settings.Center - Settings.Extent), FVector3f(Settings.Center + Settings.Extent));
+    Field->Initialise(Bounds, Settings.Resolution);
+
+    const FIntVector& Resolution = Field->GetResolution();
+    const FVector3f BaseVelocity(Settings.BaseVelocity);
+    const FVector3f Scroll(Time * Settings.TurbulenceSpeed);
+
+    // One noise lookup per axis, offset so the three components are uncorrelated
+    ParallelFor(Resolution.Z, [&](int32 Z)
+    {
+        for (int32 Y = 0; Y < Resolution.Y; Y++)
+        {
+            for (int32 X = 0; X < Resolution.X; X++)
+            {
+                const FVector NoisePosition = FVector(Field->GetSamplePosition(X, Y, Z) * Settings.TurbulenceScale + Scroll);
+                const FVector3f Turbulence(
+                    FMath::PerlinNoise3D(NoisePosition),
+                    FMath::PerlinNoise3D(NoisePosition + FVector(31.7, 0.0, 0.0)),
+                    FMath::PerlinNoise3D(NoisePosition + FVector(0.0, 57.3, 0.0)));
+
+                Field->Velocities[Field->GetIndex(X, Y, Z)] = BaseVelocity + Turbulence * Settings.TurbulenceStrength;
+            }
+        }
+    });
+
+    WindField = Field;
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClothWindField.h"
+#include "ClothWindSubsystem.generated.h"
+
+USTRUCT(BlueprintType)
+struct FClothWindFieldSettings
+{
+    GENERATED_BODY()
+
+    // World space volume the field covers, there is no field wind outside it
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    FVector Center = FVector::ZeroVector;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    FVector Extent = FVector(1000.0f);
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    FIntVector Resolution = FIntVector(16, 16, 8);
+
+    // Constant wind everywhere in the volume
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    FVector BaseVelocity = FVector::ZeroVector;
+
+    // Strength of the noise added on top of the base velocity
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    float TurbulenceStrength = 200.0f;
+    // Noise features per cm
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    float TurbulenceScale = 0.002f;
+    // How fast the noise scrolls, 0 keeps the field static
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    float TurbulenceSpeed = 0.5f;
+    // Seconds between rebuilds of an animated field
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wind)
+    float UpdateInterval = 0.05f;
+};
+
+/**
+ * Spatially varying wind shared by every cloth in the world.
+ * The field is rebuilt on the game thread and handed out as an immutable
+ * snapshot, so a cloth stepping on a worker keeps the one it was given.
+ */
+UCLASS()
+class CLOTHSIMULATION_API UClothWindSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    UFUNCTION(BlueprintCallable)
+    void SetWindField(const FClothWindFieldSettings& _settings);
+    UFUNCTION(BlueprintCallable)
+    void ClearWindField();
+
+    // The current field, null if there is none
+    FClothWindFieldPtr GetWindField() const { return WindField; }
+
+private:
+    void RebuildField();
+
+    FClothWindFieldSettings Settings;
+    FClothWindFieldPtr WindField;
+
+    float Time = 0.0f;
+    float TimeSinceRebuild = 0.0f;
+};